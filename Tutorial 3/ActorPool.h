@@ -0,0 +1,114 @@
+#pragma once
+
+#include "PhysicsEngine.h"
+#include <functional>
+
+namespace PhysicsEngine
+{
+	///Fixed-size pool of dynamic actors of one type
+	///All actors (with their shapes and user data) are created up front. Spawn adds a free actor to the scene with a reset state
+	///and Despawn removes it again, so neither allocates and the memory is bounded by the capacity.
+	template<class T> class ActorPool
+	{
+		Scene* scene;
+		std::vector<T*> actors;
+		//the actors in the scene
+		std::vector<bool> active;
+		//indices of the actors outside of the scene (the last one is spawned next)
+		std::vector<PxU32> free_actors;
+
+		void Release()
+		{
+			for (PxU32 i = 0; i < actors.size(); i++)
+			{
+				PxActor* px_actor = actors[i]->Get();
+				delete actors[i];
+				px_actor->release();
+			}
+			actors.clear();
+		}
+
+	public:
+		///Create capacity actors with a factory, the actors have to be rigid dynamics
+		ActorPool(Scene* _scene, PxU32 capacity, const std::function<T*()>& create)
+			: scene(_scene), active(capacity, false)
+		{
+			actors.reserve(capacity);
+			free_actors.reserve(capacity);
+			try
+			{
+				for (PxU32 i = 0; i < capacity; i++)
+				{
+					actors.push_back(create());
+					if (!actors.back()->Get()->isRigidDynamic())
+						throw new Exception("ActorPool::ActorPool, Pooled actors have to be rigid dynamics.");
+					free_actors.push_back(capacity - 1 - i);
+				}
+			}
+			catch (Exception*)
+			{
+				Release();
+				throw;
+			}
+		}
+
+		///Release all actors (spawned actors are removed from the scene)
+		~ActorPool()
+		{
+			Release();
+		}
+
+		///Add a free actor to the scene at the given pose and velocity (0 when all actors are in the scene)
+		T* Spawn(const PxTransform& pose, const PxVec3& linear_velocity=PxVec3(0.f), const PxVec3& angular_velocity=PxVec3(0.f))
+		{
+			if (free_actors.empty())
+				return 0;
+
+			PxU32 index = free_actors.back();
+			free_actors.pop_back();
+			active[index] = true;
+
+			PxRigidDynamic* body = (PxRigidDynamic*)actors[index]->Get();
+			body->setGlobalPose(pose);
+			scene->Add(actors[index]);
+			body->setLinearVelocity(linear_velocity);
+			body->setAngularVelocity(angular_velocity);
+			body->wakeUp();
+			return actors[index];
+		}
+
+		///Remove an actor from the scene and return it to the pool (false if it is not a spawned actor of the pool)
+		bool Despawn(T* actor)
+		{
+			for (PxU32 i = 0; i < actors.size(); i++)
+			{
+				if ((actors[i] != actor) || !active[i])
+					continue;
+
+				//move the selection (and its highlight) off the actor first
+				if (scene->GetSelectedActor() == (PxRigidDynamic*)actor->Get())
+					scene->SelectNextActor();
+
+				scene->Get()->removeActor(*actor->Get());
+				active[i] = false;
+				free_actors.push_back(i);
+				return true;
+			}
+			return false;
+		}
+
+		///Return all spawned actors to the pool
+		void DespawnAll()
+		{
+			for (PxU32 i = 0; i < actors.size(); i++)
+				if (active[i])
+					Despawn(actors[i]);
+		}
+
+		///Number of actors in the pool
+		PxU32 Capacity() { return (PxU32)actors.size(); }
+
+		///Number of actors in the scene
+		PxU32 Spawned() { return (PxU32)(actors.size() - free_actors.size()); }
+	};
+}
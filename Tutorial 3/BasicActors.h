@@ -72,17 +72,17 @@ namespace PhysicsEngine
 					else
 						vertices[offset].invWeight = 1.f;
 				}
+			}
 
-				for (PxU32 j = 0; j < height; j++)
+			for (PxU32 j = 0; j < height; j++)
+			{
+				for (PxU32 i = 0; i < width; i++)
 				{
-					for (PxU32 i = 0; i < width; i++)
-					{
-						PxU32 offset = (i + j*width) * 4;
-						quads[offset + 0] = (i + 0) + (j + 0)*(width + 1);
-						quads[offset + 1] = (i + 1) + (j + 0)*(width + 1);
-						quads[offset + 2] = (i + 1) + (j + 1)*(width + 1);
-						quads[offset + 3] = (i + 0) + (j + 1)*(width + 1);
-					}
+					PxU32 offset = (i + j*width) * 4;
+					quads[offset + 0] = (i + 0) + (j + 0)*(width + 1);
+					quads[offset + 1] = (i + 1) + (j + 0)*(width + 1);
+					quads[offset + 2] = (i + 1) + (j + 1)*(width + 1);
+					quads[offset + 3] = (i + 0) + (j + 1)*(width + 1);
 				}
 			}
 
@@ -106,13 +106,8 @@ namespace PhysicsEngine
 			actor = (PxActor*)GetPhysics()->createCloth(pose, *fabric, vertices, PxClothFlags());
 			//collisions with the scene objects
 
-			colors.push_back(default_color);
-			actor->userData = new UserData(&colors.back(), &mesh_desc);
-		}
-
-		~Cloth()
-		{
-			delete (UserData*)actor->userData;
+			render_handles.push_back(GetRenderComponents().Create(default_color, 0, &mesh_desc));
+			actor->userData = RenderUserData(render_handles.back());
 		}
 	};
 
@@ -133,139 +128,65 @@ namespace PhysicsEngine
 		}
 	};
 
-	class Course : public StaticActor
-	{
-		Course();
-
-	public:
-		Course(const PxTransform& pose = PxTransform(PxIdentity), PxVec3 dimensions = PxVec3(.5f, .5f, .5f), PxReal density = 1.f)
-			: StaticActor(pose)
-		{
-			// Stretch
-			CreateShape(PxBoxGeometry(5.f, 0.1f, 10.f), 1.f);
-			GetShape(0)->setLocalPose(PxTransform(PxVec3(0.f, 0.f, 35.f)));
-
-			// Hole left
-			CreateShape(PxBoxGeometry(2.125f, 0.1f, 5.f), 1.f);
-			GetShape(1)->setLocalPose(PxTransform(PxVec3(-2.875f, 0.f, 50.f)));
-			// Hole right
-			CreateShape(PxBoxGeometry(2.125f, 0.1f, 5.f), 1.f);
-			GetShape(2)->setLocalPose(PxTransform(PxVec3(2.875f, 0.f, 50.f)));
-			// Hole front
-			CreateShape(PxBoxGeometry(0.75f, 0.1f, 2.125f), 1.f);
-			GetShape(3)->setLocalPose(PxTransform(PxVec3(0.f, 0.f, 47.125f)));
-			// Hole back
-			CreateShape(PxBoxGeometry(0.75f, 0.1f, 2.125f), 1.f);
-			GetShape(4)->setLocalPose(PxTransform(PxVec3(0.f, 0.f, 52.875f)));
-		}
-	};
-
-	class CourseMiddle : public StaticActor
-	{
-		CourseMiddle();
-
-	public:
-		CourseMiddle(const PxTransform& pose = PxTransform(PxIdentity), PxVec3 dimensions = PxVec3(.5f, .5f, .5f), PxReal density = 1.f)
-			: StaticActor(pose)
-		{
-			// Stretch
-			CreateShape(PxBoxGeometry(5.f, 0.1f, 10.f), 1.f);
-			GetShape(0)->setLocalPose(PxTransform(PxVec3(0.f, 0.f, 15.f)));
-		}
-	};
-
-	class Barriers : public StaticActor
+	///Static triangle mesh cooked from a triangle list
+	///Each triangle references a material slot, which also selects its colour from the palette.
+	class StaticMesh : public StaticActor
 	{
-		Barriers();
+		std::vector<PxVec3> palette;
 
 	public:
-		Barriers(const PxTransform& pose = PxTransform(PxIdentity), PxVec3 dimensions = PxVec3(.5f, .5f, .5f), PxReal density = 1.f)
-			: StaticActor(pose)
+		StaticMesh(const PxTransform& pose, const std::vector<PxVec3>& verts, const std::vector<PxU32>& trigs, const std::vector<PxU16>& slots,
+			const std::vector<PxMaterial*>& materials, const std::vector<PxVec3>& colors)
+			: StaticActor(pose), palette(colors)
 		{
-			// Back barrier
-			CreateShape(PxBoxGeometry(5.f, 0.5f, 0.1f), 1.f);
-			GetShape(0)->setLocalPose(PxTransform(PxVec3(0.f, 0.5f, 55.f)));
-
-			// Left barrier
-			CreateShape(PxBoxGeometry(0.1f, 0.5f, 25.f), 1.f);
-			GetShape(1)->setLocalPose(PxTransform(PxVec3(5.f, 0.5f, 30.f)));
-
-			// Right barrier
-			CreateShape(PxBoxGeometry(0.1f, 0.5f, 25.f), 1.f);
-			GetShape(2)->setLocalPose(PxTransform(PxVec3(-5.f, 0.5f, 30.f)));
+			PxTriangleMeshDesc mesh_desc;
+			mesh_desc.points.count = (PxU32)verts.size();
+			mesh_desc.points.stride = sizeof(PxVec3);
+			mesh_desc.points.data = &verts.front();
+			mesh_desc.triangles.count = (PxU32)slots.size();
+			mesh_desc.triangles.stride = 3*sizeof(PxU32);
+			mesh_desc.triangles.data = &trigs.front();
+			mesh_desc.materialIndices.stride = sizeof(PxU16);
+			mesh_desc.materialIndices.data = &slots.front();
+
+			//cook the mesh (builds the midphase tree used for collision queries)
+			PxDefaultMemoryOutputStream stream;
+			if (!GetCooking()->cookTriangleMesh(mesh_desc, stream))
+				throw new Exception("StaticMesh::StaticMesh, Could not cook the triangle mesh.");
+
+			PxDefaultMemoryInputData input(stream.getData(), stream.getSize());
+			PxTriangleMesh* mesh = GetPhysics()->createTriangleMesh(input);
+			if (!mesh)
+				throw new Exception("StaticMesh::StaticMesh, Could not create the triangle mesh.");
+
+			CreateShape(PxTriangleMeshGeometry(mesh));
+			//the shape keeps its own reference to the mesh
+			mesh->release();
+
+			GetShape()->setMaterials(&materials.front(), (PxU16)materials.size());
+			GetRenderComponents().Palette(render_handles.front(), &palette.front());
 		}
 	};
 
-	class Windmill : public StaticActor
+	///Static height field terrain
+	///Heights are given row by row, rows run along the local x axis and columns along the local z axis.
+	class HeightField : public StaticActor
 	{
-		Windmill();
-
 	public:
-		Windmill(const PxTransform& pose = PxTransform(PxIdentity), PxVec3 dimensions = PxVec3(.5f, .5f, .5f), PxReal density = 1.f)
+		HeightField(const PxTransform& pose, const std::vector<PxReal>& heights, PxU32 rows, PxU32 columns, PxReal row_scale=1.f, PxReal column_scale=1.f)
 			: StaticActor(pose)
 		{
-			// Top 1
-			CreateShape(PxBoxGeometry(5.0f, 1.0f, 4.0f), 1.f);
-			GetShape(0)->setLocalPose(PxTransform(PxVec3(0.0f, 2.f, 30.f)));
-
-			// Top 2
-			CreateShape(PxBoxGeometry(4.75f, 1.0f, 3.75f), 1.f);
-			GetShape(1)->setLocalPose(PxTransform(PxVec3(0.0f, 4.f, 30.f)));
-
-			// Top 3
-			CreateShape(PxBoxGeometry(4.5f, 1.0f, 3.5f), 1.f);
-			GetShape(2)->setLocalPose(PxTransform(PxVec3(0.0f, 6.f, 30.f)));
-
-			// Top 4
-			CreateShape(PxBoxGeometry(4.f, 2.0f, 3.f), 1.f);
-			GetShape(3)->setLocalPose(PxTransform(PxVec3(0.0f, 9.f, 30.f)));
-
-			// Left wall
-			CreateShape(PxBoxGeometry(2.25f, 0.5f, 4.0f), 1.f);
-			GetShape(4)->setLocalPose(PxTransform(PxVec3(2.75f, 0.5f, 30.0f)));
-
-			// Right wall
-			CreateShape(PxBoxGeometry(2.25f, 0.5f, 4.0f), 1.f);
-			GetShape(5)->setLocalPose(PxTransform(PxVec3(-2.75f, 0.5f, 30.0f)));
-		}
-	};
-
-	class Sails : public DynamicActor
-	{
-		Sails();
-
-	public:
-		Sails(const PxTransform& pose = PxTransform(PxIdentity), PxVec3 dimensions = PxVec3(.5f, .5f, .5f), PxReal density = 1.f)
-			: DynamicActor(pose)
-		{
-			// Sail 1
-			CreateShape(PxBoxGeometry(4.f, 1.1f, 0.1f), 1.f);
-			GetShape(0)->setLocalPose(PxTransform(PxVec3(5.f, 9.25f, 25.5f)));
-
-			// Sail 2
-			CreateShape(PxBoxGeometry(4.f, 1.1f, 0.1f), 1.f);
-			GetShape(1)->setLocalPose(PxTransform(PxVec3(-5.f, 9.25f, 25.5f)));
-
-			// Sail 3
-			CreateShape(PxBoxGeometry(1.1f, 4.f, 0.1f), 1.f);
-			GetShape(2)->setLocalPose(PxTransform(PxVec3(0.0f, 14.25f, 25.5f)));
-
-			// Sail 4
-			CreateShape(PxBoxGeometry(1.1f, 4.f, 0.1f), 1.f);
-			GetShape(3)->setLocalPose(PxTransform(PxVec3(0.0f, 4.25f, 25.5f)));
-		}
-	};
+			if ((rows < 2) || (columns < 2) || (heights.size() != rows*columns))
+				throw new Exception("HeightField::HeightField, Invalid height field dimensions.");
 
-	class TeeBox : public StaticActor
-	{
-		TeeBox();
+			PxReal height_scale;
+			PxHeightField* height_field = CreateHeightField(&heights.front(), rows, columns, height_scale);
+			if (!height_field)
+				throw new Exception("HeightField::HeightField, Could not create the height field.");
 
-	public:
-		TeeBox(const PxTransform& pose = PxTransform(PxIdentity), PxVec3 dimensions = PxVec3(.5f, .5f, .5f), PxReal density = 1.f)
-			: StaticActor(pose)
-		{
-			CreateShape(PxBoxGeometry(5.f, 0.1f, 5.f), 1.f);
-			GetShape(0)->setLocalPose(PxTransform(PxVec3(0.f, 0.f, 0.f)));
+			CreateShape(PxHeightFieldGeometry(height_field, PxMeshGeometryFlags(), height_scale, row_scale, column_scale));
+			//the shape keeps its own reference to the height field
+			height_field->release();
 		}
 	};
 
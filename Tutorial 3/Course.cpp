@@ -0,0 +1,843 @@
+#include "Course.h"
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <map>
+#include <set>
+#include <algorithm>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+	using namespace CourseFormat;
+
+	///Course compiler
+
+	static void SetName(char* dest, const string& name, PxU32 line_nb)
+	{
+		if (name.size() >= NAME_LENGTH)
+		{
+			ostringstream msg;
+			msg << "PhysicsEngine::CompileCourse, line " << line_nb << ": name '" << name << "' is too long.";
+			throw new Exception(msg.str());
+		}
+		strcpy_s(dest, NAME_LENGTH, name.c_str());
+	}
+
+	static void SetPose(Pose& pose, const PxTransform& transform)
+	{
+		pose.p[0] = transform.p.x; pose.p[1] = transform.p.y; pose.p[2] = transform.p.z;
+		pose.q[0] = transform.q.x; pose.q[1] = transform.q.y; pose.q[2] = transform.q.z; pose.q[3] = transform.q.w;
+	}
+
+	static PxTransform GetPose(const Pose& pose)
+	{
+		return PxTransform(PxVec3(pose.p[0], pose.p[1], pose.p[2]), PxQuat(pose.q[0], pose.q[1], pose.q[2], pose.q[3]));
+	}
+
+	static void ParseError(PxU32 line_nb, const string& message)
+	{
+		ostringstream msg;
+		msg << "PhysicsEngine::CompileCourse, line " << line_nb << ": " << message;
+		throw new Exception(msg.str());
+	}
+
+	static PxReal ReadReal(istringstream& line, PxU32 line_nb)
+	{
+		PxReal value;
+		if (!(line >> value))
+			ParseError(line_nb, "number expected.");
+		return value;
+	}
+
+	///Read the optional "at x y z" and "rot degrees ax ay az" modifiers
+	static PxTransform ReadPose(istringstream& line, PxU32 line_nb)
+	{
+		PxTransform pose(PxIdentity);
+		while (true)
+		{
+			streampos start = line.tellg();
+			string token;
+			if (!(line >> token))
+			{
+				line.clear();
+				break;
+			}
+
+			if (token == "at")
+			{
+				pose.p.x = ReadReal(line, line_nb);
+				pose.p.y = ReadReal(line, line_nb);
+				pose.p.z = ReadReal(line, line_nb);
+			}
+			else if (token == "rot")
+			{
+				PxReal angle = ReadReal(line, line_nb);
+				PxVec3 axis;
+				axis.x = ReadReal(line, line_nb);
+				axis.y = ReadReal(line, line_nb);
+				axis.z = ReadReal(line, line_nb);
+				if (axis.normalize() == 0.f)
+					ParseError(line_nb, "zero rotation axis.");
+				pose.q = PxQuat(angle*PxPi/180.f, axis) * pose.q;
+			}
+			else
+			{
+				line.seekg(start);
+				break;
+			}
+		}
+		return pose;
+	}
+
+	static PxI32 FindName(const vector<string>& names, const string& name)
+	{
+		for (PxU32 i = 0; i < names.size(); i++)
+			if (names[i] == name)
+				return (PxI32)i;
+		return -1;
+	}
+
+	template<class T>
+	static void Append(vector<char>& binary, const vector<T>& records)
+	{
+		if (records.size())
+			binary.insert(binary.end(), (const char*)&records.front(), (const char*)&records.front() + records.size()*sizeof(T));
+	}
+
+	void CompileCourse(const string& source, vector<char>& binary)
+	{
+		vector<MaterialRecord> materials;
+		vector<ActorRecord> actors;
+		vector<ShapeRecord> shapes;
+		vector<JointRecord> joints;
+		vector<HeightFieldRecord> heightfields;
+		vector<PxReal> heights;
+		vector<PxU32> heightfield_lines;
+		vector<string> material_names, actor_names;
+
+		//current shape properties of the actor being defined
+		PxU32 material = DEFAULT_MATERIAL;
+		PxVec3 color(default_color);
+
+		istringstream input(source);
+		string text;
+		PxU32 line_nb = 0;
+
+		while (getline(input, text))
+		{
+			line_nb++;
+
+			//strip comments
+			size_t comment = text.find('#');
+			if (comment != string::npos)
+				text.erase(comment);
+
+			istringstream line(text);
+			string keyword;
+			if (!(line >> keyword))
+				continue;
+
+			if (keyword == "material")
+			{
+				string name;
+				if (!(line >> name))
+					ParseError(line_nb, "material name expected.");
+
+				PxReal value;
+				if (line >> value)
+				{
+					//definition: material <name> <static friction> <dynamic friction> <restitution>
+					if (FindName(material_names, name) != -1)
+						ParseError(line_nb, "material '" + name + "' is already defined.");
+					MaterialRecord record;
+					SetName(record.name, name, line_nb);
+					record.static_friction = value;
+					record.dynamic_friction = ReadReal(line, line_nb);
+					record.restitution = ReadReal(line, line_nb);
+					materials.push_back(record);
+					material_names.push_back(name);
+				}
+				else
+				{
+					//selection: material <name>
+					line.clear();
+					if (!actors.size())
+						ParseError(line_nb, "material selection outside of an actor.");
+					PxI32 index = FindName(material_names, name);
+					if (index == -1)
+						ParseError(line_nb, "unknown material '" + name + "'.");
+					material = (PxU32)index;
+				}
+			}
+			else if ((keyword == "static") || (keyword == "dynamic") || (keyword == "kinematic"))
+			{
+				string name;
+				if (!(line >> name))
+					ParseError(line_nb, "actor name expected.");
+				if (FindName(actor_names, name) != -1)
+					ParseError(line_nb, "actor '" + name + "' is already defined.");
+
+				ActorRecord record;
+				SetName(record.name, name, line_nb);
+				record.type = (keyword == "static") ? STATIC : ((keyword == "dynamic") ? DYNAMIC : KINEMATIC);
+				record.flags = 0;
+				SetPose(record.pose, ReadPose(line, line_nb));
+				record.density = 1.f;
+				record.linear_damping = -1.f;
+				record.first_shape = (PxU32)shapes.size();
+				record.nb_shapes = 0;
+				actors.push_back(record);
+				actor_names.push_back(name);
+
+				material = DEFAULT_MATERIAL;
+				color = default_color;
+			}
+			else if ((keyword == "box") || (keyword == "sphere") || (keyword == "capsule") || (keyword == "heightfield"))
+			{
+				if (!actors.size())
+					ParseError(line_nb, "shape outside of an actor.");
+
+				ShapeRecord record;
+				record.size[0] = record.size[1] = record.size[2] = 0.f;
+				record.heightfield = 0;
+				if (keyword == "box")
+				{
+					record.type = BOX;
+					for (PxU32 i = 0; i < 3; i++)
+						record.size[i] = ReadReal(line, line_nb);
+				}
+				else if (keyword == "sphere")
+				{
+					record.type = SPHERE;
+					record.size[0] = ReadReal(line, line_nb);
+				}
+				else if (keyword == "capsule")
+				{
+					record.type = CAPSULE;
+					record.size[0] = ReadReal(line, line_nb);
+					record.size[1] = ReadReal(line, line_nb);
+				}
+				else
+				{
+					//heightfield <rows> <columns> <row scale> <column scale>, followed by heights lines
+					if (actors.back().type != STATIC)
+						ParseError(line_nb, "height fields require a static actor.");
+
+					HeightFieldRecord heightfield;
+					PxReal rows = ReadReal(line, line_nb);
+					PxReal columns = ReadReal(line, line_nb);
+					if ((rows < 2.f) || (columns < 2.f) || (rows != PxFloor(rows)) || (columns != PxFloor(columns)))
+						ParseError(line_nb, "height fields need at least 2 rows and 2 columns.");
+					heightfield.rows = (PxU32)rows;
+					heightfield.columns = (PxU32)columns;
+					heightfield.row_scale = ReadReal(line, line_nb);
+					heightfield.column_scale = ReadReal(line, line_nb);
+					heightfield.first_height = (PxU32)heights.size();
+
+					record.type = HEIGHTFIELD;
+					record.heightfield = (PxU32)heightfields.size();
+					heightfields.push_back(heightfield);
+					heightfield_lines.push_back(line_nb);
+				}
+				record.material = material;
+				SetPose(record.pose, ReadPose(line, line_nb));
+				record.color[0] = color.x; record.color[1] = color.y; record.color[2] = color.z;
+				shapes.push_back(record);
+				actors.back().nb_shapes++;
+			}
+			else if (keyword == "heights")
+			{
+				//heights h0 h1 ... (row by row, may span several lines)
+				if (!heightfields.size())
+					ParseError(line_nb, "heights outside of a height field.");
+				const HeightFieldRecord& heightfield = heightfields.back();
+				PxReal value;
+				while (line >> value)
+				{
+					if (heights.size() == heightfield.first_height + heightfield.rows*heightfield.columns)
+						ParseError(line_nb, "too many heights.");
+					heights.push_back(value);
+				}
+				line.clear();
+			}
+			else if (keyword == "color")
+			{
+				color.x = ReadReal(line, line_nb);
+				color.y = ReadReal(line, line_nb);
+				color.z = ReadReal(line, line_nb);
+			}
+			else if ((keyword == "density") || (keyword == "damping") || (keyword == "nogravity") || (keyword == "nosimulation"))
+			{
+				if (!actors.size())
+					ParseError(line_nb, keyword + " outside of an actor.");
+				ActorRecord& actor = actors.back();
+				if (keyword == "density")
+					actor.density = ReadReal(line, line_nb);
+				else if (keyword == "damping")
+					actor.linear_damping = ReadReal(line, line_nb);
+				else if (keyword == "nogravity")
+					actor.flags |= DISABLE_GRAVITY;
+				else
+					actor.flags |= DISABLE_SIMULATION;
+			}
+			else if (keyword == "revolute")
+			{
+				//revolute <name> <actor0|world> [at..] [rot..] <actor1> [at..] [rot..]
+				string name, actor0, actor1;
+				if (!(line >> name >> actor0))
+					ParseError(line_nb, "joint name and actors expected.");
+
+				JointRecord record;
+				SetName(record.name, name, line_nb);
+				record.type = REVOLUTE;
+				record.flags = 0;
+				record.actor0 = (actor0 == "world") ? WORLD : FindName(actor_names, actor0);
+				if ((actor0 != "world") && (record.actor0 == -1))
+					ParseError(line_nb, "unknown actor '" + actor0 + "'.");
+				SetPose(record.frame0, ReadPose(line, line_nb));
+
+				if (!(line >> actor1))
+					ParseError(line_nb, "second joint actor expected.");
+				record.actor1 = FindName(actor_names, actor1);
+				if (record.actor1 == -1)
+					ParseError(line_nb, "unknown actor '" + actor1 + "'.");
+				if (actors[record.actor1].type == STATIC)
+					ParseError(line_nb, "the second joint actor can not be static.");
+				SetPose(record.frame1, ReadPose(line, line_nb));
+
+				record.limit_lower = record.limit_upper = record.drive_velocity = 0.f;
+				joints.push_back(record);
+			}
+			else if ((keyword == "limits") || (keyword == "drive"))
+			{
+				if (!joints.size())
+					ParseError(line_nb, keyword + " outside of a joint.");
+				JointRecord& joint = joints.back();
+				if (keyword == "limits")
+				{
+					joint.limit_lower = ReadReal(line, line_nb)*PxPi/180.f;
+					joint.limit_upper = ReadReal(line, line_nb)*PxPi/180.f;
+					joint.flags |= LIMIT;
+				}
+				else
+				{
+					joint.drive_velocity = ReadReal(line, line_nb);
+					joint.flags |= DRIVE;
+				}
+			}
+			else
+				ParseError(line_nb, "unknown keyword '" + keyword + "'.");
+
+			string extra;
+			if (line >> extra)
+				ParseError(line_nb, "unexpected '" + extra + "'.");
+		}
+
+		for (PxU32 i = 0; i < heightfields.size(); i++)
+		{
+			PxU32 end = (i + 1 < heightfields.size()) ? heightfields[i+1].first_height : (PxU32)heights.size();
+			if (end - heightfields[i].first_height != heightfields[i].rows*heightfields[i].columns)
+				ParseError(heightfield_lines[i], "wrong number of heights.");
+		}
+
+		Header header;
+		header.magic = MAGIC;
+		header.version = VERSION;
+		header.nb_materials = (PxU32)materials.size();
+		header.nb_actors = (PxU32)actors.size();
+		header.nb_shapes = (PxU32)shapes.size();
+		header.nb_joints = (PxU32)joints.size();
+		header.nb_heightfields = (PxU32)heightfields.size();
+		header.nb_heights = (PxU32)heights.size();
+
+		binary.assign((const char*)&header, (const char*)&header + sizeof(Header));
+		Append(binary, materials);
+		Append(binary, actors);
+		Append(binary, shapes);
+		Append(binary, joints);
+		Append(binary, heightfields);
+		Append(binary, heights);
+	}
+
+	static void ReadFile(const string& file_name, vector<char>& data)
+	{
+		ifstream file(file_name.c_str(), ios::in | ios::binary | ios::ate);
+		if (!file)
+			throw new Exception("PhysicsEngine::ReadFile, Could not open " + file_name + ".");
+
+		streamoff size = file.tellg();
+		data.resize((size_t)size);
+		file.seekg(0, ios::beg);
+		if (size && !file.read(&data.front(), size))
+			throw new Exception("PhysicsEngine::ReadFile, Could not read " + file_name + ".");
+	}
+
+	static bool IsSource(const string& file_name)
+	{
+		const string extension(".course");
+		return (file_name.size() >= extension.size()) &&
+			(file_name.compare(file_name.size() - extension.size(), extension.size(), extension) == 0);
+	}
+
+	void CompileCourse(const string& source_file, const string& binary_file)
+	{
+		vector<char> source, binary;
+		ReadFile(source_file, source);
+		CompileCourse(string(source.begin(), source.end()), binary);
+
+		ofstream file(binary_file.c_str(), ios::out | ios::binary);
+		if (!file || !file.write(&binary.front(), binary.size()))
+			throw new Exception("PhysicsEngine::CompileCourse, Could not write " + binary_file + ".");
+	}
+
+	///Static geometry merging
+
+	///Boxes thinner than this along a horizontal axis (walls and barriers) are not merged: a triangle mesh has no volume,
+	///so a ball that crosses the surface plane within a step is pushed out on the far side instead of back.
+	static const PxReal MIN_BARRIER_THICKNESS = .5f;
+
+	///Corners of merged boxes are snapped to this grid, so touching faces have exactly equal coordinates
+	static const PxReal MERGE_GRID = 1e-4f;
+
+	///An axis aligned box of the static mesh (in the layout frame)
+	struct MergedBox
+	{
+		PxVec3 min, max;
+		PxU16 slot;
+	};
+
+	static PxReal Snap(PxReal value)
+	{
+		return floorf(value/MERGE_GRID + .5f)*MERGE_GRID;
+	}
+
+	///Find or add a material slot (a unique material and colour pair)
+	static PxU16 AddSlot(vector<PxMaterial*>& materials, vector<PxVec3>& colors, PxMaterial* material, const PxVec3& color)
+	{
+		for (PxU32 i = 0; i < materials.size(); i++)
+			if ((materials[i] == material) && (colors[i] == color))
+				return (PxU16)i;
+
+		materials.push_back(material);
+		colors.push_back(color);
+		return (PxU16)(materials.size() - 1);
+	}
+
+	///Can a static box be merged into the static mesh (pose in the layout frame, y up), gets its bounds if it can
+	///Only axis aligned boxes are merged, so the faces of touching boxes can be split on a common grid.
+	static bool Mergeable(const PxTransform& pose, const PxVec3& half_size, PxVec3& min, PxVec3& max)
+	{
+		PxVec3 axes[3] = { pose.q.getBasisVector0(), pose.q.getBasisVector1(), pose.q.getBasisVector2() };
+		PxVec3 extent(0.f);
+		for (PxU32 i = 0; i < 3; i++)
+		{
+			//thin along a mostly horizontal axis
+			if ((2.f*half_size[i] < MIN_BARRIER_THICKNESS) && (PxAbs(axes[i].y) < .7f))
+				return false;
+
+			PxVec3 axis = axes[i].abs();
+			if (PxMax(axis.x, PxMax(axis.y, axis.z)) < 1.f - 1e-4f)
+				return false;
+			extent += axis*half_size[i];
+		}
+
+		for (PxU32 i = 0; i < 3; i++)
+		{
+			min[i] = Snap(pose.p[i] - extent[i]);
+			max[i] = Snap(pose.p[i] + extent[i]);
+		}
+		return true;
+	}
+
+	static bool Touch(const MergedBox& a, const MergedBox& b)
+	{
+		for (PxU32 i = 0; i < 3; i++)
+			if ((a.min[i] > b.max[i] + MERGE_GRID*.5f) || (b.min[i] > a.max[i] + MERGE_GRID*.5f))
+				return false;
+		return true;
+	}
+
+	static bool Inside(const MergedBox& box, const PxVec3& point)
+	{
+		return (point.x >= box.min.x) && (point.x <= box.max.x) && (point.y >= box.min.y) && (point.y <= box.max.y) &&
+			(point.z >= box.min.z) && (point.z <= box.max.z);
+	}
+
+	static PxU32 FindCluster(vector<PxU32>& clusters, PxU32 i)
+	{
+		while (clusters[i] != i)
+			i = clusters[i] = clusters[clusters[i]];
+		return i;
+	}
+
+	struct VertexLess
+	{
+		bool operator()(const PxVec3& a, const PxVec3& b) const
+		{
+			return (a.x < b.x) || ((a.x == b.x) && ((a.y < b.y) || ((a.y == b.y) && (a.z < b.z))));
+		}
+	};
+
+	///A grid cell of a face: centre and facing
+	typedef pair<PxVec3, PxU32> Cell;
+
+	struct CellLess
+	{
+		bool operator()(const Cell& a, const Cell& b) const
+		{
+			return (a.second < b.second) || ((a.second == b.second) && VertexLess()(a.first, b.first));
+		}
+	};
+
+	///Triangulate the outer surface of the merged boxes
+	///Boxes that touch form a cluster. The faces of a cluster are split on the grid of all box coordinates of the cluster,
+	///so faces that meet share their vertices (no T-junctions). Grid cells covered by another box of the cluster are internal
+	///and dropped, and coplanar cells of overlapping boxes are only added once.
+	static void MergeBoxes(const vector<MergedBox>& boxes, vector<PxVec3>& verts, vector<PxU32>& trigs, vector<PxU16>& slots)
+	{
+		vector<PxU32> clusters(boxes.size());
+		for (PxU32 i = 0; i < boxes.size(); i++)
+			clusters[i] = i;
+		for (PxU32 i = 0; i < boxes.size(); i++)
+			for (PxU32 j = i + 1; j < boxes.size(); j++)
+				if (Touch(boxes[i], boxes[j]))
+					clusters[FindCluster(clusters, i)] = FindCluster(clusters, j);
+
+		map<PxVec3, PxU32, VertexLess> vertex_map;
+		for (PxU32 c = 0; c < boxes.size(); c++)
+		{
+			if (FindCluster(clusters, c) != c)
+				continue;
+
+			//the boxes and the grid of the cluster
+			vector<PxU32> members;
+			vector<PxReal> grid[3];
+			for (PxU32 i = 0; i < boxes.size(); i++)
+			{
+				if (FindCluster(clusters, i) != c)
+					continue;
+				members.push_back(i);
+				for (PxU32 k = 0; k < 3; k++)
+				{
+					grid[k].push_back(boxes[i].min[k]);
+					grid[k].push_back(boxes[i].max[k]);
+				}
+			}
+			for (PxU32 k = 0; k < 3; k++)
+			{
+				sort(grid[k].begin(), grid[k].end());
+				grid[k].erase(unique(grid[k].begin(), grid[k].end()), grid[k].end());
+			}
+
+			//cells already added, for coplanar faces of overlapping boxes
+			set<Cell, CellLess> cells;
+
+			for (PxU32 m = 0; m < members.size(); m++)
+			{
+				const MergedBox& box = boxes[members[m]];
+				for (PxU32 face = 0; face < 6; face++)
+				{
+					//a is the face normal axis, u x v = a
+					PxU32 a = face >> 1, u = (a + 1) % 3, v = (a + 2) % 3;
+					bool positive = (face & 1) != 0;
+					PxReal plane = positive ? box.max[a] : box.min[a];
+
+					vector<PxReal>::const_iterator u0 = lower_bound(grid[u].begin(), grid[u].end(), box.min[u]);
+					vector<PxReal>::const_iterator v0 = lower_bound(grid[v].begin(), grid[v].end(), box.min[v]);
+					for (vector<PxReal>::const_iterator iu = u0; (iu + 1 != grid[u].end()) && (*iu < box.max[u]); iu++)
+					{
+						for (vector<PxReal>::const_iterator iv = v0; (iv + 1 != grid[v].end()) && (*iv < box.max[v]); iv++)
+						{
+							PxVec3 centre;
+							centre[a] = plane;
+							centre[u] = (iu[0] + iu[1])*.5f;
+							centre[v] = (iv[0] + iv[1])*.5f;
+
+							//internal: the cell is covered by another box of the cluster
+							PxVec3 outside = centre;
+							outside[a] += positive ? MERGE_GRID*.5f : -MERGE_GRID*.5f;
+							bool covered = false;
+							for (PxU32 i = 0; (i < members.size()) && !covered; i++)
+								covered = Inside(boxes[members[i]], outside);
+							if (covered || !cells.insert(Cell(centre, face)).second)
+								continue;
+
+							//counter-clockwise seen from outside
+							PxU32 corners[4];
+							for (PxU32 k = 0; k < 4; k++)
+							{
+								PxVec3 corner;
+								corner[a] = plane;
+								corner[u] = iu[((k == 1) || (k == 2)) ? 1 : 0];
+								corner[v] = iv[(k >= 2) ? 1 : 0];
+								map<PxVec3, PxU32, VertexLess>::iterator it = vertex_map.find(corner);
+								if (it == vertex_map.end())
+								{
+									it = vertex_map.insert(make_pair(corner, (PxU32)verts.size())).first;
+									verts.push_back(corner);
+								}
+								corners[positive ? k : 3 - k] = it->second;
+							}
+
+							PxU32 quad[6] = { corners[0], corners[1], corners[2], corners[0], corners[2], corners[3] };
+							trigs.insert(trigs.end(), quad, quad + 6);
+							slots.insert(slots.end(), 2, box.slot);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	///CourseLayout methods
+
+	CourseLayout::CourseLayout(Scene* scene, const string& file, const PxTransform& pose, bool merge_static)
+		: merged_shapes(0), merged_triangles(0)
+	{
+		vector<char> data;
+		ReadFile(file, data);
+
+		if (IsSource(file))
+		{
+			vector<char> binary;
+			CompileCourse(string(data.begin(), data.end()), binary);
+			Build(scene, binary, pose, merge_static);
+		}
+		else
+			Build(scene, data, pose, merge_static);
+	}
+
+	CourseLayout::~CourseLayout()
+	{
+		for (PxU32 i = 0; i < joints.size(); i++)
+		{
+			joints[i]->Get()->release();
+			delete joints[i];
+		}
+
+		for (PxU32 i = 0; i < actors.size(); i++)
+		{
+			PxActor* px_actor = actors[i]->Get();
+			delete actors[i];
+			px_actor->release();
+		}
+	}
+
+	void CourseLayout::Build(Scene* scene, const vector<char>& binary, const PxTransform& pose, bool merge_static)
+	{
+		//validate the image
+		if (binary.size() < sizeof(Header))
+			throw new Exception("PhysicsEngine::CourseLayout, Invalid course file.");
+
+		const Header* header = (const Header*)&binary.front();
+		if ((header->magic != MAGIC) || (header->version != VERSION))
+			throw new Exception("PhysicsEngine::CourseLayout, Unsupported course file version.");
+
+		//in 64 bits, so the counts of a corrupted file cannot wrap the size (size_t is 32 bits on Win32)
+		PxU64 size = sizeof(Header) + (PxU64)header->nb_materials*sizeof(MaterialRecord) + (PxU64)header->nb_actors*sizeof(ActorRecord) +
+			(PxU64)header->nb_shapes*sizeof(ShapeRecord) + (PxU64)header->nb_joints*sizeof(JointRecord) +
+			(PxU64)header->nb_heightfields*sizeof(HeightFieldRecord) + (PxU64)header->nb_heights*sizeof(PxReal);
+		if ((PxU64)binary.size() != size)
+			throw new Exception("PhysicsEngine::CourseLayout, Corrupted course file.");
+
+		const MaterialRecord* material_records = (const MaterialRecord*)(header + 1);
+		const ActorRecord* actor_records = (const ActorRecord*)(material_records + header->nb_materials);
+		const ShapeRecord* shape_records = (const ShapeRecord*)(actor_records + header->nb_actors);
+		const JointRecord* joint_records = (const JointRecord*)(shape_records + header->nb_shapes);
+		const HeightFieldRecord* heightfield_records = (const HeightFieldRecord*)(joint_records + header->nb_joints);
+		const PxReal* height_records = (const PxReal*)(heightfield_records + header->nb_heightfields);
+
+		//materials
+		for (PxU32 i = 0; i < header->nb_materials; i++)
+		{
+			const MaterialRecord& record = material_records[i];
+			materials.push_back(SharedMaterial(record.static_friction, record.dynamic_friction, record.restitution));
+			material_names.push_back(string(record.name, strnlen(record.name, NAME_LENGTH)));
+		}
+
+		//merged static geometry (in the layout frame)
+		vector<MergedBox> merged_boxes;
+		vector<PxVec3> mesh_verts;
+		vector<PxU32> mesh_trigs;
+		vector<PxU16> mesh_slots;
+		vector<PxMaterial*> slot_materials;
+		vector<PxVec3> slot_colors;
+
+		//actors and shapes (record_actors maps record indices to actors, 0 for merged actors)
+		vector<Actor*> record_actors(header->nb_actors, (Actor*)0);
+		actors.reserve(header->nb_actors + 1);
+		for (PxU32 i = 0; i < header->nb_actors; i++)
+		{
+			const ActorRecord& record = actor_records[i];
+			if ((record.first_shape > header->nb_shapes) || (record.nb_shapes > header->nb_shapes - record.first_shape))
+				throw new Exception("PhysicsEngine::CourseLayout, Corrupted course file.");
+
+			//static boxes that go into the static mesh
+			vector<bool> merged_shape(record.nb_shapes, false);
+			bool merge = merge_static && (record.type == STATIC);
+			if (merge)
+			{
+				PxU32 nb_merged = 0;
+				for (PxU32 j = 0; j < record.nb_shapes; j++)
+				{
+					const ShapeRecord& shape = shape_records[record.first_shape + j];
+					MergedBox box;
+					if ((shape.type != BOX) ||
+						!Mergeable(GetPose(record.pose) * GetPose(shape.pose), PxVec3(shape.size[0], shape.size[1], shape.size[2]), box.min, box.max))
+						continue;
+
+					PxMaterial* material = (shape.material < header->nb_materials) ? materials[shape.material] : PhysicsEngine::GetMaterial();
+					PxVec3 color(shape.color[0], shape.color[1], shape.color[2]);
+					box.slot = AddSlot(slot_materials, slot_colors, material, color);
+					merged_boxes.push_back(box);
+					merged_shape[j] = true;
+					nb_merged++;
+				}
+				merged_shapes += nb_merged;
+
+				//static actors made only of boxes are fully merged
+				if (nb_merged && (nb_merged == record.nb_shapes))
+					continue;
+			}
+
+			PxTransform actor_pose = pose * GetPose(record.pose);
+			Actor* actor;
+			if (record.type == STATIC)
+				actor = new StaticActor(actor_pose);
+			else
+				actor = new DynamicActor(actor_pose);
+
+			for (PxU32 j = 0, k = 0; j < record.nb_shapes; j++)
+			{
+				const ShapeRecord& shape = shape_records[record.first_shape + j];
+				if (merged_shape[j])
+					continue;
+
+				switch (shape.type)
+				{
+				case BOX:
+					actor->CreateShape(PxBoxGeometry(shape.size[0], shape.size[1], shape.size[2]), record.density);
+					break;
+				case SPHERE:
+					actor->CreateShape(PxSphereGeometry(shape.size[0]), record.density);
+					break;
+				case CAPSULE:
+					actor->CreateShape(PxCapsuleGeometry(shape.size[0], shape.size[1]), record.density);
+					break;
+				case HEIGHTFIELD:
+				{
+					if ((record.type != STATIC) || (shape.heightfield >= header->nb_heightfields))
+						throw new Exception("PhysicsEngine::CourseLayout, Corrupted course file.");
+					const HeightFieldRecord& heightfield = heightfield_records[shape.heightfield];
+					if ((heightfield.rows < 2) || (heightfield.columns < 2) ||
+						((PxU64)heightfield.first_height + (PxU64)heightfield.rows*heightfield.columns > header->nb_heights))
+						throw new Exception("PhysicsEngine::CourseLayout, Corrupted course file.");
+
+					PxReal height_scale;
+					PxHeightField* height_field = CreateHeightField(height_records + heightfield.first_height, heightfield.rows, heightfield.columns, height_scale);
+					if (!height_field)
+						throw new Exception("PhysicsEngine::CourseLayout, Could not create the height field.");
+					actor->CreateShape(PxHeightFieldGeometry(height_field, PxMeshGeometryFlags(), height_scale, heightfield.row_scale, heightfield.column_scale), record.density);
+					//the shape keeps its own reference to the height field
+					height_field->release();
+					break;
+				}
+				default:
+					throw new Exception("PhysicsEngine::CourseLayout, Unknown shape type.");
+				}
+
+				actor->GetShape(k)->setLocalPose(GetPose(shape.pose));
+				actor->Color(PxVec3(shape.color[0], shape.color[1], shape.color[2]), k);
+				if (shape.material < header->nb_materials)
+					actor->Material(materials[shape.material], k);
+				k++;
+			}
+
+			if (record.type != STATIC)
+			{
+				PxRigidDynamic* body = (PxRigidDynamic*)actor->Get();
+				//mass properties of the final shape layout
+				PxRigidBodyExt::updateMassAndInertia(*body, record.density);
+				if (record.type == KINEMATIC)
+					((DynamicActor*)actor)->SetKinematic(true);
+				if (record.linear_damping >= 0.f)
+					body->setLinearDamping(record.linear_damping);
+			}
+
+			if (record.flags & DISABLE_GRAVITY)
+				actor->Get()->setActorFlag(PxActorFlag::eDISABLE_GRAVITY, true);
+			if (record.flags & DISABLE_SIMULATION)
+				actor->Get()->setActorFlag(PxActorFlag::eDISABLE_SIMULATION, true);
+
+			string name(record.name, strnlen(record.name, NAME_LENGTH));
+			actor->Name(name);
+			actors.push_back(actor);
+			actor_names.push_back(name);
+			record_actors[i] = actor;
+		}
+
+		StaticMesh* static_mesh = 0;
+		MergeBoxes(merged_boxes, mesh_verts, mesh_trigs, mesh_slots);
+		if (mesh_slots.size())
+		{
+			static_mesh = new StaticMesh(pose, mesh_verts, mesh_trigs, mesh_slots, slot_materials, slot_colors);
+			static_mesh->Name("static");
+			actors.push_back(static_mesh);
+			actor_names.push_back("static");
+			merged_triangles = (PxU32)mesh_slots.size();
+		}
+
+		//add all actors in a single call
+		scene->Add(actors);
+
+		//joints (drives need the actors in the scene to wake them up)
+		for (PxU32 i = 0; i < header->nb_joints; i++)
+		{
+			const JointRecord& record = joint_records[i];
+			if ((record.actor0 < WORLD) || (record.actor0 >= (PxI32)header->nb_actors) || (record.actor1 < 0) || (record.actor1 >= (PxI32)header->nb_actors) ||
+				!record_actors[record.actor1])
+				throw new Exception("PhysicsEngine::CourseLayout, Corrupted course file.");
+
+			Actor* actor0 = 0;
+			PxTransform frame0 = GetPose(record.frame0);
+			if (record.actor0 == WORLD)
+				frame0 = pose * frame0;
+			else if (record_actors[record.actor0])
+				actor0 = record_actors[record.actor0];
+			else
+			{
+				//attached to a merged static actor, use the static mesh frame instead
+				actor0 = static_mesh;
+				frame0 = GetPose(actor_records[record.actor0].pose) * frame0;
+			}
+
+			RevoluteJoint* joint = new RevoluteJoint(actor0, frame0, record_actors[record.actor1], GetPose(record.frame1));
+			if (record.flags & LIMIT)
+				joint->SetLimits(record.limit_lower, record.limit_upper);
+			if (record.flags & DRIVE)
+				joint->DriveVelocity(record.drive_velocity);
+
+			joints.push_back(joint);
+			joint_names.push_back(string(record.name, strnlen(record.name, NAME_LENGTH)));
+		}
+	}
+
+	Actor* CourseLayout::GetActor(const string& name)
+	{
+		PxI32 index = FindName(actor_names, name);
+		return (index != -1) ? actors[index] : 0;
+	}
+
+	Joint* CourseLayout::GetJoint(const string& name)
+	{
+		PxI32 index = FindName(joint_names, name);
+		return (index != -1) ? joints[index] : 0;
+	}
+
+	PxMaterial* CourseLayout::GetMaterial(const string& name)
+	{
+		PxI32 index = FindName(material_names, name);
+		return (index != -1) ? materials[index] : 0;
+	}
+}
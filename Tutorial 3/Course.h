@@ -0,0 +1,172 @@
+#pragma once
+
+#include "BasicActors.h"
+#include <string>
+#include <vector>
+
+namespace PhysicsEngine
+{
+	///Binary course format
+	///
+	///A compiled course is a header followed by flat arrays of materials, actors, shapes, joints,
+	///height fields and height samples.
+	///All records are plain 4-byte aligned structures so a course loads with a single read.
+	namespace CourseFormat
+	{
+		static const PxU32 MAGIC = 0x31535243; //"CRS1"
+		static const PxU32 VERSION = 2;
+		static const PxU32 NAME_LENGTH = 32;
+		static const PxU32 DEFAULT_MATERIAL = 0xffffffff;
+		static const PxI32 WORLD = -1;
+
+		enum ActorType
+		{
+			STATIC,
+			DYNAMIC,
+			KINEMATIC
+		};
+
+		enum ActorFlag
+		{
+			DISABLE_GRAVITY = 1,
+			DISABLE_SIMULATION = 2
+		};
+
+		enum ShapeType
+		{
+			BOX,
+			SPHERE,
+			CAPSULE,
+			HEIGHTFIELD
+		};
+
+		enum JointType
+		{
+			REVOLUTE
+		};
+
+		enum JointFlag
+		{
+			LIMIT = 1,
+			DRIVE = 2
+		};
+
+		struct Pose
+		{
+			PxReal p[3];
+			PxReal q[4];
+		};
+
+		struct Header
+		{
+			PxU32 magic;
+			PxU32 version;
+			PxU32 nb_materials;
+			PxU32 nb_actors;
+			PxU32 nb_shapes;
+			PxU32 nb_joints;
+			PxU32 nb_heightfields;
+			PxU32 nb_heights;
+		};
+
+		struct MaterialRecord
+		{
+			char name[NAME_LENGTH];
+			PxReal static_friction;
+			PxReal dynamic_friction;
+			PxReal restitution;
+		};
+
+		struct ActorRecord
+		{
+			char name[NAME_LENGTH];
+			PxU32 type;
+			PxU32 flags;
+			Pose pose;
+			PxReal density;
+			PxReal linear_damping;
+			PxU32 first_shape;
+			PxU32 nb_shapes;
+		};
+
+		struct ShapeRecord
+		{
+			PxU32 type;
+			PxU32 material;
+			PxReal size[3];
+			Pose pose;
+			PxReal color[3];
+			PxU32 heightfield; //height field record of HEIGHTFIELD shapes
+		};
+
+		struct JointRecord
+		{
+			char name[NAME_LENGTH];
+			PxU32 type;
+			PxU32 flags;
+			PxI32 actor0;
+			PxI32 actor1;
+			Pose frame0;
+			Pose frame1;
+			PxReal limit_lower;
+			PxReal limit_upper;
+			PxReal drive_velocity;
+		};
+
+		struct HeightFieldRecord
+		{
+			PxU32 rows;
+			PxU32 columns;
+			PxReal row_scale;
+			PxReal column_scale;
+			PxU32 first_height;
+		};
+	}
+
+	///Compile a text course description into a binary course image
+	void CompileCourse(const std::string& source, std::vector<char>& binary);
+
+	///Compile a text course file into a binary course file
+	void CompileCourse(const std::string& source_file, const std::string& binary_file);
+
+	///A course built from a course file
+	///Accepts both the text source (.course) and the compiled binary format.
+	///With merge_static, the boxes of all static actors are merged into a single cooked triangle mesh
+	///(one broadphase entry and one render buffer per layout) named "static". The mesh is the closed outer surface of the
+	///boxes: faces where boxes touch or overlap are removed and touching faces share their vertices. Thin walls and barriers
+	///and rotated boxes stay boxes.
+	class CourseLayout
+	{
+		std::vector<Actor*> actors;
+		std::vector<Joint*> joints;
+		std::vector<PxMaterial*> materials;
+		std::vector<std::string> actor_names, joint_names, material_names;
+		PxU32 merged_shapes, merged_triangles;
+
+		void Build(Scene* scene, const std::vector<char>& binary, const PxTransform& pose, bool merge_static);
+
+	public:
+		///Load a course and add all of its actors to the scene
+		CourseLayout(Scene* scene, const std::string& file, const PxTransform& pose=PxTransform(PxIdentity), bool merge_static=true);
+
+		~CourseLayout();
+
+		///Find an actor by name (0 if not found)
+		Actor* GetActor(const std::string& name);
+
+		///Find a joint by name (0 if not found)
+		Joint* GetJoint(const std::string& name);
+
+		///Find a material by name (0 if not found)
+		PxMaterial* GetMaterial(const std::string& name);
+
+		///All actors of the course
+		const std::vector<Actor*>& GetActors() { return actors; }
+
+		///Number of static shapes merged into the static mesh
+		PxU32 MergedShapes() { return merged_shapes; }
+
+		///Number of triangles of the static mesh
+		PxU32 MergedTriangles() { return merged_triangles; }
+	};
+}
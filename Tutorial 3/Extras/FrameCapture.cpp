@@ -0,0 +1,195 @@
+#include "FrameCapture.h"
+#include "..\Exception.h"
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+
+namespace VisualDebugger
+{
+	FrameCapture::FrameCapture(const std::string& _prefix, int _width, int _height, Format _format)
+		: prefix(_prefix), format(_format), width(_width), height(_height), issued(0), stopped(false), stopping(false), failed(false)
+	{
+		if (format == RAW)
+		{
+			raw_file.open((prefix + ".rgb").c_str(), std::ios::out | std::ios::binary);
+			if (!raw_file)
+				throw new Exception("FrameCapture::FrameCapture, Could not open the video file.");
+		}
+
+		pixel_buffers = VertexBuffer::PixelBuffersSupported();
+		for (unsigned int i = 0; i < PIXEL_BUFFERS; i++)
+		{
+			readback[i] = 0;
+			if (pixel_buffers)
+			{
+				readback[i] = new VertexBuffer(GL_PIXEL_PACK_BUFFER);
+				readback[i]->Data(0, width*height*3, GL_STREAM_READ);
+			}
+		}
+
+		//all frame memory is allocated up front, the writer recycles it
+		frames.resize(FRAME_POOL);
+		for (unsigned int i = 0; i < FRAME_POOL; i++)
+		{
+			frames[i].resize(width*height*3);
+			free_frames.push_back(i);
+		}
+
+		writer = std::thread(&FrameCapture::WriterLoop, this);
+	}
+
+	FrameCapture::~FrameCapture()
+	{
+		Stop();
+
+		for (unsigned int i = 0; i < PIXEL_BUFFERS; i++)
+			delete readback[i];
+	}
+
+	void FrameCapture::Stop()
+	{
+		if (stopped)
+			return;
+		stopped = true;
+
+		//collect the reads that are still in flight
+		if (pixel_buffers)
+		{
+			unsigned int first = (issued > PIXEL_BUFFERS) ? issued - PIXEL_BUFFERS : 0;
+			for (unsigned int number = first; number < issued; number++)
+				Collect(number);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		frame_queued.notify_one();
+		writer.join();
+	}
+
+	void FrameCapture::Capture()
+	{
+		if (stopped)
+			return;
+
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+		if (!pixel_buffers)
+		{
+			unsigned int frame = AcquireFrame();
+			glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &frames[frame].front());
+			Submit(frame, issued++);
+			return;
+		}
+
+		//the slot still holds the read issued PIXEL_BUFFERS frames ago, which has completed by now
+		if (issued >= PIXEL_BUFFERS)
+			Collect(issued - PIXEL_BUFFERS);
+
+		VertexBuffer* buffer = readback[issued % PIXEL_BUFFERS];
+		glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, (GLvoid*)buffer->Bind());
+		VertexBuffer::Unbind(GL_PIXEL_PACK_BUFFER);
+		issued++;
+	}
+
+	bool FrameCapture::Failed()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		return failed;
+	}
+
+	unsigned int FrameCapture::AcquireFrame()
+	{
+		//wait for the writer rather than dropping frames
+		std::unique_lock<std::mutex> lock(mutex);
+		while (free_frames.empty())
+			frame_freed.wait(lock);
+
+		unsigned int frame = free_frames.front();
+		free_frames.pop_front();
+		return frame;
+	}
+
+	void FrameCapture::Submit(unsigned int frame, unsigned int number)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			queued_frames.push_back(std::make_pair(frame, number));
+		}
+		frame_queued.notify_one();
+	}
+
+	void FrameCapture::Collect(unsigned int number)
+	{
+		VertexBuffer* buffer = readback[number % PIXEL_BUFFERS];
+		unsigned int frame = AcquireFrame();
+
+		const void* pixels = buffer->Map(GL_READ_ONLY);
+		if (pixels)
+			memcpy(&frames[frame].front(), pixels, frames[frame].size());
+		buffer->Unmap();
+
+		//the frame memory holds an older frame, return it to the pool instead of writing it
+		if (!pixels)
+		{
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				failed = true;
+				free_frames.push_back(frame);
+			}
+			frame_freed.notify_one();
+			return;
+		}
+
+		Submit(frame, number);
+	}
+
+	void FrameCapture::Write(const std::vector<unsigned char>& pixels, unsigned int number)
+	{
+		//GL rows run from bottom to top, both formats store the top row first
+		std::ofstream image;
+		std::ostream* output = &raw_file;
+		if (format == PPM)
+		{
+			std::ostringstream file_name;
+			file_name << prefix << "_" << std::setw(5) << std::setfill('0') << number << ".ppm";
+			image.open(file_name.str().c_str(), std::ios::out | std::ios::binary);
+			image << "P6\n" << width << " " << height << "\n255\n";
+			output = &image;
+		}
+
+		for (int y = height - 1; y >= 0; y--)
+			output->write((const char*)&pixels[y*width*3], width*3);
+
+		if (!*output)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			failed = true;
+		}
+	}
+
+	void FrameCapture::WriterLoop()
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		for (;;)
+		{
+			while (queued_frames.empty() && !stopping)
+				frame_queued.wait(lock);
+
+			if (queued_frames.empty())
+				break;
+
+			std::pair<unsigned int, unsigned int> item = queued_frames.front();
+			queued_frames.pop_front();
+
+			//the frame memory is owned by the writer until it is returned to the pool
+			lock.unlock();
+			Write(frames[item.first], item.second);
+			lock.lock();
+
+			free_frames.push_back(item.first);
+			frame_freed.notify_one();
+		}
+	}
+}
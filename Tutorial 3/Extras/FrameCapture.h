@@ -0,0 +1,76 @@
+#pragma once
+
+#include "VertexBuffer.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace VisualDebugger
+{
+	///Asynchronous frame capture
+	///Frames are read back through a ring of pixel buffer objects and mapped only when their slot is reused,
+	///so glReadPixels never waits for the GPU. Writing to disk happens on a background thread.
+	///Without pixel buffer object support frames are read back directly.
+	class FrameCapture
+	{
+	public:
+		enum Format
+		{
+			PPM,	//one binary PPM image per frame: <prefix>_00000.ppm
+			RAW		//all frames appended to <prefix>.rgb (raw rgb24 video, top row first)
+		};
+
+	private:
+		static const unsigned int PIXEL_BUFFERS = 3;
+		static const unsigned int FRAME_POOL = 8;
+
+		std::string prefix;
+		Format format;
+		int width, height;
+		bool pixel_buffers;
+		VertexBuffer* readback[PIXEL_BUFFERS];
+		unsigned int issued;
+		bool stopped;
+
+		//frame memory shared with the writer thread
+		std::vector<std::vector<unsigned char> > frames;
+		std::deque<unsigned int> free_frames;
+		std::deque<std::pair<unsigned int, unsigned int> > queued_frames;
+		std::mutex mutex;
+		std::condition_variable frame_queued, frame_freed;
+		bool stopping, failed;
+		std::ofstream raw_file;
+		std::thread writer;
+
+		FrameCapture(const FrameCapture&);
+		FrameCapture& operator=(const FrameCapture&);
+
+		unsigned int AcquireFrame();
+		void Submit(unsigned int frame, unsigned int number);
+		void Collect(unsigned int number);
+		void Write(const std::vector<unsigned char>& pixels, unsigned int number);
+		void WriterLoop();
+
+	public:
+		///Start capturing frames of the given size (needs a current GL context)
+		FrameCapture(const std::string& prefix, int width, int height, Format format=PPM);
+
+		~FrameCapture();
+
+		///Write the remaining frames and stop the writer thread (no captures afterwards)
+		void Stop();
+
+		///Read back the current frame (call after rendering, before the buffers are swapped)
+		void Capture();
+
+		///Number of captured frames
+		unsigned int Frames() { return issued; }
+
+		///Check if writing any of the frames has failed
+		bool Failed();
+	};
+}
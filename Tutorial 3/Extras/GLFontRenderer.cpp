@@ -1,10 +1,15 @@
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
+#include <stddef.h>
 #include <GL/glut.h>
+#include <string>
+#include <vector>
+#include <map>
 
 #include "GLFontData.h"
 #include "GLFontRenderer.h"
+#include "VertexBuffer.h"
 
 bool GLFontRenderer::m_isInit=false;
 unsigned int GLFontRenderer::m_textureObject=0;
@@ -12,6 +17,28 @@ int GLFontRenderer::m_screenWidth=640;
 int GLFontRenderer::m_screenHeight=480;
 float GLFontRenderer::m_color[4]={1.0f, 1.0f, 1.0f, 1.0f};
 
+// Text is not drawn by print() but queued for flush(), which draws all strings of a frame
+// with a single state setup and a single glDrawArrays call. The glyph geometry of every string
+// is cached (keyed by the string and its layout) so that unchanged strings are not rebuilt, and
+// the batch buffer is only uploaded again when the list of queued texts (or their revisions)
+// has changed since the last frame. Callers with larger static blocks keep their own GLFontText.
+struct TextGeometry
+{
+	GLFontText text;
+	unsigned int frame;
+};
+
+// a queued text and the revision of its geometry at the time it was queued
+typedef std::pair<const GLFontText*, unsigned int> TextItem;
+
+static std::map<std::string, TextGeometry> textCache;
+static std::vector<TextItem> textItems;
+static std::vector<TextItem> textLastItems;
+static std::vector<GLFontVertex> textVertices;
+static VisualDebugger::VertexBuffer* textBuffer = 0;
+static unsigned int textFrame = 0;
+static unsigned int textRevision = 0;
+
 bool GLFontRenderer::init()
 {
 	glGenTextures(1, &m_textureObject);
@@ -33,22 +60,139 @@ bool GLFontRenderer::init()
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, OGL_FONT_TEXTURE_WIDTH, OGL_FONT_TEXTURE_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, pNewSource);
 	delete[] pNewSource;
 
+	textBuffer = new VisualDebugger::VertexBuffer();
+
 	return true;
 }
 
-void GLFontRenderer::print(float x, float y, float fontSize, const char* pString, bool forceMonoSpace, int monoSpaceWidth, bool doOrthoProj)
+static void appendKey(std::string& key, const void* data, size_t size)
 {
-	x = x*m_screenWidth;
-	y = y*m_screenHeight;
-	fontSize = fontSize*m_screenHeight;
+	key.append((const char*)data, size);
+}
+
+static void buildText(std::vector<GLFontVertex>& vertices, float x, float y, float fontSize, const char* pString, unsigned int num,
+	bool forceMonoSpace, int monoSpaceWidth, int screenHeight, const float* color)
+{
+	unsigned char rgba[4];
+	for(int i=0;i<4;i++)
+	{
+		float c = color[i] < 0.0f ? 0.0f : (color[i] > 1.0f ? 1.0f : color[i]);
+		rgba[i] = (unsigned char)(c*255.0f+0.5f);
+	}
+
+	const float glyphHeightUV = ((float)OGL_FONT_CHARS_PER_COL)/OGL_FONT_TEXTURE_HEIGHT*2-0.01f;
+	const float glyphWidthUV = ((float)OGL_FONT_CHARS_PER_ROW)/OGL_FONT_TEXTURE_WIDTH;
+
+	float translate = 0.0f;
+	float translateDown = 0.0f;
+
+	for(unsigned int i=0;i<num; i++)
+	{
+		if (pString[i] == '\n') {
+			translateDown-=0.005f*screenHeight+fontSize;
+			translate = 0.0f;
+			continue;
+		}
+
+		int c = pString[i]-OGL_FONT_CHAR_BASE;
+		if (c < OGL_FONT_CHARS_PER_ROW*OGL_FONT_CHARS_PER_COL) {
+
+			float glyphWidth = (float)GLFontGlyphWidth[c];
+			if(forceMonoSpace){
+				glyphWidth = (float)monoSpaceWidth;
+			}
+
+			glyphWidth = glyphWidth*(fontSize/(((float)OGL_FONT_TEXTURE_WIDTH)/OGL_FONT_CHARS_PER_ROW))-0.01f;
+
+			float cxUV = float((c)%OGL_FONT_CHARS_PER_ROW)/OGL_FONT_CHARS_PER_ROW+0.008f;
+			float cyUV = float((c)/OGL_FONT_CHARS_PER_ROW)/OGL_FONT_CHARS_PER_COL+0.008f;
+
+			float x0 = x+translate, x1 = x+fontSize+translate;
+			float y0 = y+translateDown, y1 = y+fontSize+translateDown;
+
+			const GLFontVertex quad[6] = {
+				{ x0, y0, cxUV, cyUV+glyphHeightUV },
+				{ x1, y1, cxUV+glyphWidthUV, cyUV },
+				{ x0, y1, cxUV, cyUV },
+				{ x0, y0, cxUV, cyUV+glyphHeightUV },
+				{ x1, y0, cxUV+glyphWidthUV, cyUV+glyphHeightUV },
+				{ x1, y1, cxUV+glyphWidthUV, cyUV },
+			};
+
+			for(int j=0;j<6;j++)
+			{
+				vertices.push_back(quad[j]);
+				memcpy(vertices.back().color, rgba, sizeof(rgba));
+			}
+
+			translate+=glyphWidth;
+		}
+	}
+}
+
+void GLFontRenderer::print(float x, float y, float fontSize, const char* pString, bool forceMonoSpace, int monoSpaceWidth)
+{
+	unsigned int num = (unsigned int)strlen(pString);
+	if(num == 0)
+		return;
+
+	// everything the geometry depends on is part of the key
+	std::string key(pString, num);
+	key.push_back('\0');
+	appendKey(key, &x, sizeof(x));
+	appendKey(key, &y, sizeof(y));
+	appendKey(key, &fontSize, sizeof(fontSize));
+	appendKey(key, &forceMonoSpace, sizeof(forceMonoSpace));
+	appendKey(key, &monoSpaceWidth, sizeof(monoSpaceWidth));
+	appendKey(key, &m_screenWidth, sizeof(m_screenWidth));
+	appendKey(key, &m_screenHeight, sizeof(m_screenHeight));
+	appendKey(key, m_color, sizeof(m_color));
+
+	std::map<std::string, TextGeometry>::iterator it = textCache.find(key);
+	if(it == textCache.end())
+	{
+		it = textCache.insert(std::make_pair(key, TextGeometry())).first;
+		build(it->second.text, x, y, fontSize, pString, forceMonoSpace, monoSpaceWidth);
+	}
+
+	it->second.frame = textFrame;
+	draw(it->second.text);
+}
 
+void GLFontRenderer::build(GLFontText& text, float x, float y, float fontSize, const char* pString, bool forceMonoSpace, int monoSpaceWidth)
+{
+	buildText(text.vertices, x*m_screenWidth, y*m_screenHeight, fontSize*m_screenHeight, pString, (unsigned int)strlen(pString),
+		forceMonoSpace, monoSpaceWidth, m_screenHeight, m_color);
+	text.revision = ++textRevision;
+}
+
+void GLFontRenderer::draw(const GLFontText& text)
+{
+	if(!text.vertices.empty())
+		textItems.push_back(TextItem(&text, text.revision));
+}
+
+void GLFontRenderer::flush()
+{
 	if(!m_isInit)
 	{
 		m_isInit = init();
 	}
 
-	unsigned int num = (unsigned int)strlen(pString);
-	if(m_isInit && num > 0)
+	// the buffer only changes when the strings of this frame differ from the last one
+	if(m_isInit && (textItems != textLastItems))
+	{
+		textVertices.clear();
+		for(size_t i=0;i<textItems.size();i++)
+			textVertices.insert(textVertices.end(), textItems[i].first->vertices.begin(), textItems[i].first->vertices.end());
+
+		if(textVertices.size())
+			textBuffer->Data(&textVertices.front(), textVertices.size()*sizeof(GLFontVertex), GL_DYNAMIC_DRAW);
+		else
+			textBuffer->Data(0, 0, GL_DYNAMIC_DRAW);
+	}
+
+	if(m_isInit && textBuffer->Size())
 	{
 		glBlendFunc(GL_SRC_ALPHA,GL_ONE_MINUS_SRC_ALPHA);
 		glDisable(GL_DEPTH_TEST);
@@ -57,123 +201,52 @@ void GLFontRenderer::print(float x, float y, float fontSize, const char* pString
 		glEnable(GL_TEXTURE_2D);
 		glBindTexture(GL_TEXTURE_2D, m_textureObject);
 
-
-		if(doOrthoProj)
-		{
-			glMatrixMode(GL_PROJECTION);
-			glPushMatrix();
-			glLoadIdentity();
-			glOrtho(0, m_screenWidth, 0, m_screenHeight, -1, 1);
-		}
+		glMatrixMode(GL_PROJECTION);
+		glPushMatrix();
+		glLoadIdentity();
+		glOrtho(0, m_screenWidth, 0, m_screenHeight, -1, 1);
 		glMatrixMode(GL_MODELVIEW);
 		glPushMatrix();
 		glLoadIdentity();
 
 		glEnable(GL_BLEND);
 
-		glColor4f(m_color[0], m_color[1], m_color[2], m_color[3]);
-
-		const float glyphHeightUV = ((float)OGL_FONT_CHARS_PER_COL)/OGL_FONT_TEXTURE_HEIGHT*2-0.01f;
-
-		float translate = 0.0f;
-
-		float* pVertList = new float[num*3*6];
-    	float* pTextureCoordList = new float[num*2*6];
-		int vertIndex = 0;
-    	int textureCoordIndex = 0;
-
-		float translateDown = 0.0f;
-		unsigned int count = 0;
-
-		for(unsigned int i=0;i<num; i++)
-		{
-			const float glyphWidthUV = ((float)OGL_FONT_CHARS_PER_ROW)/OGL_FONT_TEXTURE_WIDTH;
-
-			if (pString[i] == '\n') {
-				translateDown-=0.005f*m_screenHeight+fontSize;
-				translate = 0.0f;
-				continue;
-			}
-
-			int c = pString[i]-OGL_FONT_CHAR_BASE;
-			if (c < OGL_FONT_CHARS_PER_ROW*OGL_FONT_CHARS_PER_COL) {
-
-				count++;
-
-				float glyphWidth = (float)GLFontGlyphWidth[c];
-				if(forceMonoSpace){
-					glyphWidth = (float)monoSpaceWidth;
-				}
-				
-				glyphWidth = glyphWidth*(fontSize/(((float)OGL_FONT_TEXTURE_WIDTH)/OGL_FONT_CHARS_PER_ROW))-0.01f;
-
-				float cxUV = float((c)%OGL_FONT_CHARS_PER_ROW)/OGL_FONT_CHARS_PER_ROW+0.008f;
-				float cyUV = float((c)/OGL_FONT_CHARS_PER_ROW)/OGL_FONT_CHARS_PER_COL+0.008f;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV+glyphHeightUV;
-				pVertList[vertIndex++] = x+0+translate;
-				pVertList[vertIndex++] = y+0+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV+glyphWidthUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV;
-				pVertList[vertIndex++] = x+fontSize+translate;
-				pVertList[vertIndex++] = y+fontSize+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV;
-				pVertList[vertIndex++] = x+0+translate;
-				pVertList[vertIndex++] = y+fontSize+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV+glyphHeightUV;
-				pVertList[vertIndex++] = x+0+translate;
-				pVertList[vertIndex++] = y+0+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV+glyphWidthUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV+glyphHeightUV;
-				pVertList[vertIndex++] = x+fontSize+translate;
-				pVertList[vertIndex++] = y+0+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				pTextureCoordList[textureCoordIndex++] = cxUV+glyphWidthUV;
-				pTextureCoordList[textureCoordIndex++] = cyUV;
-				pVertList[vertIndex++] = x+fontSize+translate;
-				pVertList[vertIndex++] = y+fontSize+translateDown;
-				pVertList[vertIndex++] = 0;
-
-				translate+=glyphWidth;
-			}
-		}
-
+		const char* base = textBuffer->Bind();
 		glEnableClientState(GL_VERTEX_ARRAY);
-		glVertexPointer(3, GL_FLOAT, 0, pVertList);
+		glVertexPointer(2, GL_FLOAT, sizeof(GLFontVertex), base + offsetof(GLFontVertex, x));
 		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-		glTexCoordPointer(2, GL_FLOAT, 0, pTextureCoordList);
-		glDrawArrays(GL_TRIANGLES, 0, count*6);
+		glTexCoordPointer(2, GL_FLOAT, sizeof(GLFontVertex), base + offsetof(GLFontVertex, u));
+		glEnableClientState(GL_COLOR_ARRAY);
+		glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(GLFontVertex), base + offsetof(GLFontVertex, color));
+		glDrawArrays(GL_TRIANGLES, 0, (GLsizei)(textBuffer->Size()/sizeof(GLFontVertex)));
+		glDisableClientState(GL_COLOR_ARRAY);
 		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
 		glDisableClientState(GL_VERTEX_ARRAY);
+		VisualDebugger::VertexBuffer::Unbind();
 
-		delete[] pVertList;
-		delete[] pTextureCoordList;
-
-		if(doOrthoProj)
-		{
-			glMatrixMode(GL_PROJECTION);
-			glPopMatrix();
-		}
+		glMatrixMode(GL_PROJECTION);
+		glPopMatrix();
 		glMatrixMode(GL_MODELVIEW);
 		glPopMatrix();
-		
+
 		glEnable(GL_DEPTH_TEST);
 		glEnable(GL_LIGHTING);
-		glDisable(GL_TEXTURE_2D);	
+		glDisable(GL_TEXTURE_2D);
 		glDisable(GL_BLEND);
 	}
+
+	// drop the geometry of strings that were not printed in this frame
+	for(std::map<std::string, TextGeometry>::iterator it = textCache.begin(); it != textCache.end();)
+	{
+		if(it->second.frame != textFrame)
+			textCache.erase(it++);
+		else
+			++it;
+	}
+
+	textLastItems.swap(textItems);
+	textItems.clear();
+	textFrame++;
 }
 
 void GLFontRenderer::setScreenResolution(int screenWidth, int screenHeight)
@@ -9,6 +9,28 @@
 #ifndef __GL_FONT_RENDERER__
 #define __GL_FONT_RENDERER__
 
+#include <vector>
+
+struct GLFontVertex
+{
+	float x, y;
+	float u, v;
+	unsigned char color[4];
+};
+
+// retained text geometry: built once with GLFontRenderer::build and queued every frame with GLFontRenderer::draw
+class GLFontText{
+
+public:
+
+	std::vector<GLFontVertex> vertices;
+	unsigned int revision;
+
+	GLFontText() : revision(0) {}
+
+	void clear() { vertices.clear(); }
+};
+
 class GLFontRenderer{
 	
 private:
@@ -22,7 +44,14 @@ private:
 public:
 	
 	static bool init();
-	static void print(float x, float y, float fontSize, const char* pString, bool forceMonoSpace=false, int monoSpaceWidth=11, bool doOrthoProj=true);
+	// queue a string for the current frame (drawn by flush)
+	static void print(float x, float y, float fontSize, const char* pString, bool forceMonoSpace=false, int monoSpaceWidth=11);
+	// append the glyphs of a string to retained text geometry (current colour and screen resolution)
+	static void build(GLFontText& text, float x, float y, float fontSize, const char* pString, bool forceMonoSpace=false, int monoSpaceWidth=11);
+	// queue retained text geometry for the current frame (must stay alive until flush)
+	static void draw(const GLFontText& text);
+	// draw all strings queued in this frame with a single draw call
+	static void flush();
 	static void setScreenResolution(int screenWidth, int screenHeight);
 	static void setColor(float r, float g, float b, float a);
 	
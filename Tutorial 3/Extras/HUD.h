@@ -2,24 +2,30 @@
 
 #include "Renderer.h"
 #include <string>
-#include <list>
+#include <vector>
+#include <map>
 
 namespace VisualDebugger
 {
 	using namespace std;
 
 	///A single HUD screen
+	///The lines are compiled into a retained text block, which is rebuilt only when
+	///the content, font size, colour or render target size changes.
 	class HUDScreen
 	{
 		vector<string> content;
+		PxReal font_size;
+		PxVec3 color;
+		GLFontText text;
+		bool dirty;
+		int screen_width, screen_height;
 
 	public:
 		int id;
-		PxReal font_size;
-		PxVec3 color;
 
 		HUDScreen(int screen_id, const PxVec3& _color=PxVec3(1.f,1.f,1.f), const PxReal& _font_size=0.024f) :
-			id(screen_id), color(_color), font_size(_font_size)
+			font_size(_font_size), color(_color), dirty(true), screen_width(0), screen_height(0), id(screen_id)
 		{
 		}
 
@@ -27,19 +33,82 @@ namespace VisualDebugger
 		void AddLine(string line)
 		{
 			content.push_back(line);
+			dirty = true;
+		}
+
+		///Replace a single line of text (only marks the screen dirty if the line has changed)
+		void SetLine(unsigned int index, const string& line)
+		{
+			if (index >= content.size())
+				content.resize(index+1);
+
+			if (content[index] != line)
+			{
+				content[index] = line;
+				dirty = true;
+			}
+		}
+
+		///Set the font size
+		void FontSize(PxReal value)
+		{
+			if (value != font_size)
+			{
+				font_size = value;
+				dirty = true;
+			}
+		}
+
+		///Get the font size
+		PxReal FontSize()
+		{
+			return font_size;
+		}
+
+		///Set the color
+		void Color(const PxVec3& value)
+		{
+			if (value != color)
+			{
+				color = value;
+				dirty = true;
+			}
+		}
+
+		///Get the color
+		const PxVec3& Color()
+		{
+			return color;
 		}
 
 		///Render the screen
 		void Render()
 		{
-			for (unsigned int i = 0; i < content.size(); i++)
-				Renderer::RenderText(content[i], PxVec2(0.0, 1.f-(i+1)*font_size), color, font_size);
+			int width = Renderer::Width();
+			int height = Renderer::Height();
+
+			if (dirty || (width != screen_width) || (height != screen_height))
+			{
+				text.clear();
+				for (unsigned int i = 0; i < content.size(); i++)
+					Renderer::BuildText(text, content[i], PxVec2(0.0, 1.f-(i+1)*font_size), color, font_size);
+
+				dirty = false;
+				screen_width = width;
+				screen_height = height;
+			}
+
+			Renderer::RenderText(text);
 		}
 
 		///Clear content of the screen
 		void Clear()
 		{
-			content.clear();
+			if (content.size())
+			{
+				content.clear();
+				dirty = true;
+			}
 		}
 	};
 
@@ -47,29 +116,52 @@ namespace VisualDebugger
 	class HUD
 	{
 		int active_screen;
-		vector<HUDScreen*> screens;
+		map<int, HUDScreen*> screens;
+
+		///Find a screen by id (0 if not found)
+		HUDScreen* GetScreen(int screen_id)
+		{
+			map<int, HUDScreen*>::iterator it = screens.find(screen_id);
+			if (it != screens.end())
+				return it->second;
+			return 0;
+		}
 
 	public:
+		HUD() : active_screen(-1)
+		{
+		}
+
 		~HUD()
 		{
-			for (unsigned int i = 0; i < screens.size(); i++)
-				delete screens[i];
+			for (map<int, HUDScreen*>::iterator it = screens.begin(); it != screens.end(); it++)
+				delete it->second;
 		}
 
 		///Add a single line to a specific screen
 		void AddLine(int screen_id, string line)
 		{
-			for (unsigned int i = 0; i < screens.size(); i++)
+			HUDScreen* screen = GetScreen(screen_id);
+			if (!screen)
 			{
-				if (screens[i]->id == screen_id)
-				{
-					screens[i]->AddLine(line);
-					return;
-				}
+				screen = new HUDScreen(screen_id);
+				screens[screen_id] = screen;
 			}
 
-			screens.push_back(new HUDScreen(screen_id));
-			screens.back()->AddLine(line);
+			screen->AddLine(line);
+		}
+
+		///Replace a single line of a specific screen (cheap when the line is unchanged)
+		void SetLine(int screen_id, unsigned int index, const string& line)
+		{
+			HUDScreen* screen = GetScreen(screen_id);
+			if (!screen)
+			{
+				screen = new HUDScreen(screen_id);
+				screens[screen_id] = screen;
+			}
+
+			screen->SetLine(index, line);
 		}
 
 		///Set the active screen
@@ -89,21 +181,12 @@ namespace VisualDebugger
 		{
 			if (screen_id == -1)
 			{
-				for (unsigned int i = 0; i < screens.size(); i++)
-				{
-					screens[i]->Clear();
-				}
+				for (map<int, HUDScreen*>::iterator it = screens.begin(); it != screens.end(); it++)
+					it->second->Clear();
 			}
-			else
+			else if (HUDScreen* screen = GetScreen(screen_id))
 			{
-				for (unsigned int i = 0; i < screens.size(); i++)
-				{
-					if (screens[i]->id == screen_id)
-					{
-						screens[i]->Clear();
-						return;
-					}
-				}
+				screen->Clear();
 			}
 		}
 
@@ -112,21 +195,12 @@ namespace VisualDebugger
 		{
 			if (screen_id == -1)
 			{
-				for (unsigned int i = 0; i < screens.size(); i++)
-				{
-					screens[i]->font_size = font_size;
-				}
+				for (map<int, HUDScreen*>::iterator it = screens.begin(); it != screens.end(); it++)
+					it->second->FontSize(font_size);
 			}
-			else
+			else if (HUDScreen* screen = GetScreen((int)screen_id))
 			{
-				for (unsigned int i = 0; i < screens.size(); i++)
-				{
-					if (screens[i]->id == screen_id)
-					{
-						screens[i]->font_size = font_size;
-						return;
-					}
-				}
+				screen->FontSize(font_size);
 			}
 		}
 
@@ -135,35 +209,20 @@ namespace VisualDebugger
 		{
 			if (screen_id == -1)
 			{
-				for (unsigned int i = 0; i < screens.size(); i++)
-				{
-					screens[i]->color = color;
-				}
+				for (map<int, HUDScreen*>::iterator it = screens.begin(); it != screens.end(); it++)
+					it->second->Color(color);
 			}
-			else
+			else if (HUDScreen* screen = GetScreen((int)screen_id))
 			{
-				for (unsigned int i = 0; i < screens.size(); i++)
-				{
-					if (screens[i]->id == screen_id)
-					{
-						screens[i]->color = color;
-						return;
-					}
-				}
+				screen->Color(color);
 			}
 		}
 
 		///Render the active screen
 		void Render()
 		{
-			for (unsigned int i = 0; i < screens.size(); i++)
-			{
-				if (screens[i]->id == active_screen)
-				{
-					screens[i]->Render();
-					return;
-				}
-			}
+			if (HUDScreen* screen = GetScreen(active_screen))
+				screen->Render();
 		}
 	};
-}
\ No newline at end of file
+}
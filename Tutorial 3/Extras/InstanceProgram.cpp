@@ -0,0 +1,248 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+#include "InstanceProgram.h"
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+
+#ifndef GL_VERTEX_SHADER
+#define GL_VERTEX_SHADER 0x8B31
+#define GL_COMPILE_STATUS 0x8B81
+#define GL_LINK_STATUS 0x8B82
+#define GL_INFO_LOG_LENGTH 0x8B84
+#endif
+
+namespace VisualDebugger
+{
+	typedef GLuint (APIENTRY *CreateShaderProc)(GLenum type);
+	typedef void (APIENTRY *ShaderSourceProc)(GLuint shader, GLsizei count, const char* const* strings, const GLint* lengths);
+	typedef void (APIENTRY *CompileShaderProc)(GLuint shader);
+	typedef void (APIENTRY *GetShaderivProc)(GLuint shader, GLenum name, GLint* value);
+	typedef void (APIENTRY *GetShaderInfoLogProc)(GLuint shader, GLsizei size, GLsizei* length, char* log);
+	typedef void (APIENTRY *DeleteShaderProc)(GLuint shader);
+	typedef GLuint (APIENTRY *CreateProgramProc)();
+	typedef void (APIENTRY *AttachShaderProc)(GLuint program, GLuint shader);
+	typedef void (APIENTRY *BindAttribLocationProc)(GLuint program, GLuint index, const char* name);
+	typedef void (APIENTRY *LinkProgramProc)(GLuint program);
+	typedef void (APIENTRY *GetProgramivProc)(GLuint program, GLenum name, GLint* value);
+	typedef void (APIENTRY *DeleteProgramProc)(GLuint program);
+	typedef void (APIENTRY *UseProgramProc)(GLuint program);
+	typedef GLint (APIENTRY *GetUniformLocationProc)(GLuint program, const char* name);
+	typedef void (APIENTRY *Uniform1iProc)(GLint location, GLint value);
+	typedef void (APIENTRY *Uniform3fProc)(GLint location, GLfloat x, GLfloat y, GLfloat z);
+	typedef void (APIENTRY *VertexAttribPointerProc)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
+	typedef void (APIENTRY *EnableVertexAttribArrayProc)(GLuint index);
+	typedef void (APIENTRY *DisableVertexAttribArrayProc)(GLuint index);
+	typedef void (APIENTRY *VertexAttribDivisorProc)(GLuint index, GLuint divisor);
+	typedef void (APIENTRY *DrawArraysInstancedProc)(GLenum mode, GLint first, GLsizei count, GLsizei instances);
+
+	static CreateShaderProc glCreateShader = 0;
+	static ShaderSourceProc glShaderSource = 0;
+	static CompileShaderProc glCompileShader = 0;
+	static GetShaderivProc glGetShaderiv = 0;
+	static GetShaderInfoLogProc glGetShaderInfoLog = 0;
+	static DeleteShaderProc glDeleteShader = 0;
+	static CreateProgramProc glCreateProgram = 0;
+	static AttachShaderProc glAttachShader = 0;
+	static BindAttribLocationProc glBindAttribLocation = 0;
+	static LinkProgramProc glLinkProgram = 0;
+	static GetProgramivProc glGetProgramiv = 0;
+	static DeleteProgramProc glDeleteProgram = 0;
+	static UseProgramProc glUseProgram = 0;
+	static GetUniformLocationProc glGetUniformLocation = 0;
+	static Uniform1iProc glUniform1i = 0;
+	static Uniform3fProc glUniform3f = 0;
+	static VertexAttribPointerProc glVertexAttribPointer = 0;
+	static EnableVertexAttribArrayProc glEnableVertexAttribArray = 0;
+	static DisableVertexAttribArrayProc glDisableVertexAttribArray = 0;
+	static VertexAttribDivisorProc glVertexAttribDivisorARB = 0;
+	static DrawArraysInstancedProc glDrawArraysInstancedARB = 0;
+
+	///Same light model as the fixed function setup of the renderer:
+	///global and light 0 ambient, light 0 diffuse and specular, material ambient and diffuse from the colour
+	static const char* vertex_source =
+		"#version 120\n"
+		"attribute vec3 position;\n"
+		"attribute vec3 normal;\n"
+		"attribute float end;\n"
+		"attribute mat4 world;\n"
+		"attribute vec4 scale;\n"
+		"attribute vec3 color;\n"
+		"uniform bool lit;\n"
+		"uniform vec3 unlit_color;\n"
+		"void main()\n"
+		"{\n"
+		"	vec3 local = position*scale.xyz;\n"
+		"	local.x += end*scale.w;\n"
+		"	gl_Position = gl_ModelViewProjectionMatrix*(world*vec4(local, 1.0));\n"
+		"	if (!lit)\n"
+		"	{\n"
+		"		gl_FrontColor = vec4(unlit_color, 1.0);\n"
+		"		return;\n"
+		"	}\n"
+		"	vec3 n = normalize(gl_NormalMatrix*(mat3(world)*normal));\n"
+		"	vec3 l = normalize(gl_LightSource[0].position.xyz);\n"
+		"	float diffuse = max(dot(n, l), 0.0);\n"
+		"	vec3 result = (gl_LightModel.ambient.rgb + gl_LightSource[0].ambient.rgb + gl_LightSource[0].diffuse.rgb*diffuse)*color;\n"
+		"	if (diffuse > 0.0)\n"
+		"		result += gl_FrontMaterial.specular.rgb*gl_LightSource[0].specular.rgb*\n"
+		"			pow(max(dot(n, normalize(gl_LightSource[0].halfVector.xyz)), 0.0), gl_FrontMaterial.shininess);\n"
+		"	gl_FrontColor = vec4(result, 1.0);\n"
+		"}\n";
+
+	static const char* attribute_names[] = { "position", "normal", "end", "world" };
+
+	///Load the program and instancing entry points (needs a current GL context)
+	static bool LoadExtension()
+	{
+		static bool loaded = false;
+		static bool supported = false;
+
+		if (loaded)
+			return supported;
+
+		const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+		const char* version = (const char*)glGetString(GL_VERSION);
+		if (!extensions || !version)
+			return false;
+
+		loaded = true;
+
+		//vertex programs are core since 2.0, the window system hands out entry points even when they are missing
+		if (atoi(version) < 2 || !strstr(extensions, "GL_ARB_instanced_arrays") || !strstr(extensions, "GL_ARB_draw_instanced"))
+			return false;
+
+		glCreateShader = (CreateShaderProc)GetGLProcAddress("glCreateShader");
+		glShaderSource = (ShaderSourceProc)GetGLProcAddress("glShaderSource");
+		glCompileShader = (CompileShaderProc)GetGLProcAddress("glCompileShader");
+		glGetShaderiv = (GetShaderivProc)GetGLProcAddress("glGetShaderiv");
+		glGetShaderInfoLog = (GetShaderInfoLogProc)GetGLProcAddress("glGetShaderInfoLog");
+		glDeleteShader = (DeleteShaderProc)GetGLProcAddress("glDeleteShader");
+		glCreateProgram = (CreateProgramProc)GetGLProcAddress("glCreateProgram");
+		glAttachShader = (AttachShaderProc)GetGLProcAddress("glAttachShader");
+		glBindAttribLocation = (BindAttribLocationProc)GetGLProcAddress("glBindAttribLocation");
+		glLinkProgram = (LinkProgramProc)GetGLProcAddress("glLinkProgram");
+		glGetProgramiv = (GetProgramivProc)GetGLProcAddress("glGetProgramiv");
+		glDeleteProgram = (DeleteProgramProc)GetGLProcAddress("glDeleteProgram");
+		glUseProgram = (UseProgramProc)GetGLProcAddress("glUseProgram");
+		glGetUniformLocation = (GetUniformLocationProc)GetGLProcAddress("glGetUniformLocation");
+		glUniform1i = (Uniform1iProc)GetGLProcAddress("glUniform1i");
+		glUniform3f = (Uniform3fProc)GetGLProcAddress("glUniform3f");
+		glVertexAttribPointer = (VertexAttribPointerProc)GetGLProcAddress("glVertexAttribPointer");
+		glEnableVertexAttribArray = (EnableVertexAttribArrayProc)GetGLProcAddress("glEnableVertexAttribArray");
+		glDisableVertexAttribArray = (DisableVertexAttribArrayProc)GetGLProcAddress("glDisableVertexAttribArray");
+		glVertexAttribDivisorARB = (VertexAttribDivisorProc)GetGLProcAddress("glVertexAttribDivisorARB");
+		glDrawArraysInstancedARB = (DrawArraysInstancedProc)GetGLProcAddress("glDrawArraysInstancedARB");
+
+		supported = glCreateShader && glShaderSource && glCompileShader && glGetShaderiv && glGetShaderInfoLog && glDeleteShader &&
+			glCreateProgram && glAttachShader && glBindAttribLocation && glLinkProgram && glGetProgramiv && glDeleteProgram &&
+			glUseProgram && glGetUniformLocation && glUniform1i && glUniform3f && glVertexAttribPointer &&
+			glEnableVertexAttribArray && glDisableVertexAttribArray && glVertexAttribDivisorARB && glDrawArraysInstancedARB;
+		return supported;
+	}
+
+	bool InstanceProgram::Supported()
+	{
+		return LoadExtension();
+	}
+
+	InstanceProgram::InstanceProgram()
+		: program(0), lit_location(-1), color_location(-1), enabled(0)
+	{
+	}
+
+	InstanceProgram::~InstanceProgram()
+	{
+		if (program)
+			glDeleteProgram(program);
+	}
+
+	bool InstanceProgram::Create()
+	{
+		if (program)
+			return true;
+		if (!Supported())
+			return false;
+
+		GLuint shader = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(shader, 1, &vertex_source, 0);
+		glCompileShader(shader);
+
+		GLint status = 0;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+		if (!status)
+		{
+			char log[1024] = "";
+			glGetShaderInfoLog(shader, sizeof(log), 0, log);
+			std::cerr << "InstanceProgram::Create, Could not compile the vertex program: " << log << std::endl;
+			glDeleteShader(shader);
+			return false;
+		}
+
+		program = glCreateProgram();
+		glAttachShader(program, shader);
+		//the fixed locations let the renderer set attributes without looking them up
+		for (GLuint i = 0; i <= WORLD; i++)
+			glBindAttribLocation(program, i, attribute_names[i]);
+		glBindAttribLocation(program, SCALE, "scale");
+		glBindAttribLocation(program, COLOR, "color");
+		glLinkProgram(program);
+		//the program keeps the shader until it is deleted itself
+		glDeleteShader(shader);
+
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
+		if (!status)
+		{
+			std::cerr << "InstanceProgram::Create, Could not link the vertex program." << std::endl;
+			glDeleteProgram(program);
+			program = 0;
+			return false;
+		}
+
+		lit_location = glGetUniformLocation(program, "lit");
+		color_location = glGetUniformLocation(program, "unlit_color");
+		return true;
+	}
+
+	void InstanceProgram::Begin(bool lit, const GLfloat* color)
+	{
+		glUseProgram(program);
+		glUniform1i(lit_location, lit);
+		if (color)
+			glUniform3f(color_location, color[0], color[1], color[2]);
+	}
+
+	void InstanceProgram::Pointer(Attribute attribute, GLint size, GLsizei stride, const char* pointer, bool per_instance)
+	{
+		if (!(enabled & (1u << attribute)))
+		{
+			glEnableVertexAttribArray(attribute);
+			enabled |= 1u << attribute;
+		}
+		glVertexAttribPointer(attribute, size, GL_FLOAT, GL_FALSE, stride, pointer);
+		glVertexAttribDivisorARB(attribute, per_instance ? 1 : 0);
+	}
+
+	void InstanceProgram::Draw(GLsizei count, GLsizei instances)
+	{
+		glDrawArraysInstancedARB(GL_TRIANGLES, 0, count, instances);
+	}
+
+	void InstanceProgram::End()
+	{
+		//divisors are not part of the program, reset them so later attribute arrays are per vertex again
+		for (GLuint i = 0; i < ATTRIBUTES; i++)
+		{
+			if (enabled & (1u << i))
+			{
+				glVertexAttribDivisorARB(i, 0);
+				glDisableVertexAttribArray(i);
+			}
+		}
+		enabled = 0;
+		glUseProgram(0);
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "VertexBuffer.h"
+
+namespace VisualDebugger
+{
+	///Vertex program drawing many copies of a unit mesh with one call (GLSL, ARB_instanced_arrays and ARB_draw_instanced)
+	///Unit mesh and instance data come from generic vertex attributes. Lit draws use light 0 like the fixed function
+	///pipeline with the instance colour as the material, unlit draws (shadows) use a single colour.
+	class InstanceProgram
+	{
+		GLuint program;
+		GLint lit_location, color_location;
+		//attributes enabled since Begin (one bit each)
+		unsigned int enabled;
+
+		InstanceProgram(const InstanceProgram&);
+		InstanceProgram& operator=(const InstanceProgram&);
+
+	public:
+		///Generic attribute locations, the world matrix takes four (one per column)
+		enum Attribute
+		{
+			POSITION,	//vec3 unit mesh position
+			NORMAL,		//vec3 unit mesh normal
+			END,		//float capsule end (+1 or -1), moved along x by the half height
+			WORLD,		//mat4 world pose
+			SCALE=WORLD+4,	//vec4 scale of the unit mesh and the half height
+			COLOR,		//vec3 instance colour
+			ATTRIBUTES
+		};
+
+		InstanceProgram();
+
+		~InstanceProgram();
+
+		///Compile and link the program (needs a current GL context, false on failure)
+		bool Create();
+
+		///Use the program for the following draws, unlit draws use the given colour
+		void Begin(bool lit, const GLfloat* color=0);
+
+		///Set the source of an attribute, per instance attributes advance once per instance
+		void Pointer(Attribute attribute, GLint size, GLsizei stride, const char* pointer, bool per_instance=false);
+
+		///Draw the unit mesh (count vertices) for the given number of instances
+		void Draw(GLsizei count, GLsizei instances);
+
+		///Disable the attributes and return to the fixed function pipeline
+		void End();
+
+		///Check if the driver supports instanced drawing with vertex programs
+		static bool Supported();
+	};
+}
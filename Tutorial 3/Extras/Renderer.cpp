@@ -1,7 +1,34 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
 #include "Renderer.h"
 #include <iostream>
 #include <vector>
+#include <map>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 #include "UserData.h"
+#include "VertexBuffer.h"
+#include "InstanceProgram.h"
+#include "FrameCapture.h"
+#include "..\Exception.h"
+
+#ifdef RENDERER_OSMESA
+#include <GL/osmesa.h>
+#endif
+
+#ifndef _WIN32
+#include <GL/glx.h>
+#endif
 
 using namespace std;
 
@@ -11,9 +38,42 @@ namespace VisualDebugger
 	{
 		PxVec3 default_color = PxVec3(0.8f, 0.8f, 0.8f);
 		PxVec3 background_color = PxVec3(0.f,0.f,0.f);
+
+		///render target size (window or offscreen buffer)
+		int target_width = 512, target_height = 512;
+		bool offscreen = false;
+
+		///frame pacing
+		typedef std::chrono::high_resolution_clock Clock;
+		PxReal frame_rate = 60.f;
+		bool low_power = false;
+		static const PxReal LOW_POWER_RATE = 10.f;
+		//longest sleep of a single idle call, keeps input latency low at low frame rates
+		static const PxReal MAX_IDLE_SLEEP = .01f;
+		Clock::time_point next_frame;
+
+		///active frame capture (0 if not capturing)
+		FrameCapture* frame_capture = 0;
+
+#ifdef RENDERER_OSMESA
+		OSMesaContext offscreen_context = 0;
+		std::vector<GLubyte> offscreen_buffer;
+#endif
 		int render_detail = 10;
 		bool show_shadows = true;
 
+		//perspective projection of the camera
+		static const PxReal camera_fov = 60.f;
+		static const PxReal camera_near = 1.f;
+		static const PxReal camera_far = 10000.f;
+		PxVec3 camera_eye = PxVec3(0.f, 0.f, 0.f);
+		//size in pixels of a unit length at a unit distance from the camera
+		PxReal pixel_scale = 1.f;
+
+		///Projection onto the ground plane along the light direction
+		static const PxVec3 shadow_dir(-0.7071067f, -0.7071067f, -0.7071067f);
+		static const PxReal shadow_matrix[] = { 1,0,0,0, -shadow_dir.x/shadow_dir.y,0,-shadow_dir.z/shadow_dir.y,0, 0,0,1,0, 0,0,0,1 };
+
 		static float gPlaneData[]={
 			-1.f, 0.f, -1.f, 0.f, 1.f, 0.f, -1.f, 0.f, 1.f, 0.f, 1.f, 0.f,
 			1.f, 0.f, 1.f, 0.f, 1.f, 0.f, -1.f, 0.f, -1.f, 0.f, 1.f, 0.f,
@@ -32,121 +92,890 @@ namespace VisualDebugger
 			glDisableClientState(GL_NORMAL_ARRAY);
 		}
 
-		void DrawSphere(const PxGeometryHolder& geometry)
+		///Interleaved vertex of the cached mesh buffers
+		struct MeshVertex
+		{
+			PxVec3 position;
+			PxVec3 normal;
+			PxVec3 color;
+		};
+
+		///Cached render buffer of a convex or triangle mesh (flat shaded, non-indexed)
+		///A buffer is shared by all shapes using the same mesh and counts them as references.
+		struct MeshBuffer
 		{
-			glutSolidSphere(geometry.sphere().radius, render_detail, render_detail);
+			VertexBuffer vertices;
+			PxU32 nb_verts;
+			bool colored;
+			const PxBase* mesh;
+			PxU32 references;
+		};
+
+		//cached buffers by mesh and the buffer referenced by each shape
+		std::map<const PxBase*, MeshBuffer*> mesh_buffers;
+		std::map<const PxBase*, MeshBuffer*> shape_buffers;
+
+		///Drop the reference of a shape, the last reference releases the buffer
+		void ReleaseShapeBuffer(std::map<const PxBase*, MeshBuffer*>::iterator it)
+		{
+			MeshBuffer* buffer = it->second;
+			shape_buffers.erase(it);
+			if (!--buffer->references)
+			{
+				mesh_buffers.erase(buffer->mesh);
+				delete buffer;
+			}
 		}
 
-		void DrawBox(const PxGeometryHolder& geometry)
+		///Number of height field cells along each side of a render chunk
+		static const PxU32 HEIGHTFIELD_CHUNK = 32;
+
+		///Vertex of the cached height field buffers
+		struct HeightFieldVertex
+		{
+			PxVec3 position;
+			PxVec3 normal;
+		};
+
+		///A block of height field cells drawn with a single call
+		struct HeightFieldChunk
+		{
+			PxU32 first_index;
+			PxU32 nb_indices;
+			PxBounds3 bounds;
+		};
+
+		///Cached render buffers of a height field (shared vertices, one index range per chunk)
+		struct HeightFieldBuffer
+		{
+			VertexBuffer vertices;
+			VertexBuffer indices;
+			std::vector<HeightFieldChunk> chunks;
+			PxReal height_scale, row_scale, column_scale;
+
+			HeightFieldBuffer() : indices(GL_ELEMENT_ARRAY_BUFFER) {}
+		};
+
+		std::map<const PxBase*, HeightFieldBuffer*> heightfield_buffers;
+
+		///Render buffers of a cloth (positions and normals are streamed every frame)
+		struct ClothBuffer
+		{
+			VertexBuffer positions;
+			VertexBuffer normals;
+			VertexBuffer quads;
+			std::vector<PxVec4> normal_data;
+
+			ClothBuffer() : quads(GL_ELEMENT_ARRAY_BUFFER) {}
+		};
+
+		std::map<const PxBase*, ClothBuffer*> cloth_buffers;
+
+		///View frustum given by six planes facing inwards
+		struct Frustum
+		{
+			PxPlane planes[6];
+
+			Frustum() {}
+
+			///Extract the planes of a combined projection and modelview matrix
+			Frustum(const PxMat44& clip)
+			{
+				//left, right, bottom, top, near and far
+				for (PxU32 i = 0; i < 6; i++)
+				{
+					PxU32 row = i / 2;
+					PxReal sign = (i & 1) ? -1.f : 1.f;
+					planes[i] = PxPlane(clip(3,0) + sign*clip(row,0), clip(3,1) + sign*clip(row,1),
+						clip(3,2) + sign*clip(row,2), clip(3,3) + sign*clip(row,3));
+					planes[i].normalize();
+				}
+			}
+
+			///Check if a box is at least partially inside the frustum
+			bool Visible(const PxBounds3& bounds) const
+			{
+				for (PxU32 i = 0; i < 6; i++)
+				{
+					//the box corner furthest along the plane normal
+					const PxVec3& n = planes[i].n;
+					PxVec3 corner((n.x > 0.f) ? bounds.maximum.x : bounds.minimum.x,
+						(n.y > 0.f) ? bounds.maximum.y : bounds.minimum.y,
+						(n.z > 0.f) ? bounds.maximum.z : bounds.minimum.z);
+					if (planes[i].distance(corner) < 0.f)
+						return false;
+				}
+				return true;
+			}
+		};
+
+		//the camera frustum of the current frame and the number of shapes culled by it
+		Frustum view_frustum;
+		PxU32 culled_shapes = 0;
+
+		///Combined projection and view matrix of the camera (as set up by gluPerspective and gluLookAt)
+		PxMat44 CameraMatrix(const PxVec3& eye, const PxVec3& dir, PxReal aspect)
 		{
-			PxVec3 half_size = geometry.box().halfExtents;
-			glScalef(half_size.x, half_size.y, half_size.z);
-			glutSolidCube(2.f);		
+			PxVec3 f = dir.getNormalized();
+			PxVec3 s = f.cross(PxVec3(0.f, 1.f, 0.f)).getNormalized();
+			PxVec3 u = s.cross(f);
+			PxMat44 view(PxVec4(s.x, u.x, -f.x, 0.f), PxVec4(s.y, u.y, -f.y, 0.f), PxVec4(s.z, u.z, -f.z, 0.f),
+				PxVec4(-s.dot(eye), -u.dot(eye), f.dot(eye), 1.f));
+
+			PxReal focal = 1.f / PxTan(camera_fov*PxPi/360.f);
+			PxMat44 projection(PxVec4(focal/aspect, 0.f, 0.f, 0.f), PxVec4(0.f, focal, 0.f, 0.f),
+				PxVec4(0.f, 0.f, (camera_far + camera_near)/(camera_near - camera_far), -1.f),
+				PxVec4(0.f, 0.f, 2.f*camera_far*camera_near/(camera_near - camera_far), 0.f));
+
+			return projection * view;
 		}
 
-		void DrawCapsule(const PxGeometryHolder& geometry)
+		///Check if a box or its shadow on the ground is in the view
+		bool Visible(const PxBounds3& bounds)
 		{
-			const PxF32 radius = geometry.capsule().radius;
-			const PxF32 halfHeight = geometry.capsule().halfHeight;
+			if (view_frustum.Visible(bounds))
+				return true;
 
-			//Sphere
-			glPushMatrix();
-			glTranslatef(halfHeight,0.f, 0.f);
-			glutSolidSphere(radius, render_detail, render_detail);		
-			glPopMatrix();
+			if (!show_shadows)
+				return false;
 
-			//Sphere
-			glPushMatrix();
-			glTranslatef(-halfHeight,0.f,0.f);
-			glutSolidSphere(radius, render_detail, render_detail);		
-			glPopMatrix();
+			PxBounds3 shadow = PxBounds3::empty();
+			for (PxU32 i = 0; i < 8; i++)
+			{
+				PxVec3 corner((i & 1) ? bounds.maximum.x : bounds.minimum.x, (i & 2) ? bounds.maximum.y : bounds.minimum.y,
+					(i & 4) ? bounds.maximum.z : bounds.minimum.z);
+				shadow.include(PxVec3(corner.x - corner.y*shadow_dir.x/shadow_dir.y, 0.f, corner.z - corner.y*shadow_dir.z/shadow_dir.y));
+			}
+			return view_frustum.Visible(shadow);
+		}
 
-			//Cylinder
-			glPushMatrix();
-			glTranslatef(-halfHeight,0.f,0.f);
-			glRotatef(90.f,0.f,1.f,0.f);
+		///Objects released since the last frame (releases can happen on the simulation thread)
+		std::vector<const PxBase*> released_objects;
+		std::mutex release_mutex;
 
-			GLUquadric* qobj = gluNewQuadric();
-			gluQuadricNormals(qobj, GLU_SMOOTH);
-			gluCylinder(qobj, radius, radius, halfHeight*2.f, render_detail, render_detail);
-			gluDeleteQuadric(qobj);
-			glPopMatrix();
+		///Queue released shapes, height fields and cloths, their buffers are dropped by the render thread
+		class MeshDeletionListener : public PxDeletionListener
+		{
+		public:
+			virtual void onRelease(const PxBase* observed, void* userData, PxDeletionEventFlag::Enum deletionEvent)
+			{
+				std::lock_guard<std::mutex> lock(release_mutex);
+				released_objects.push_back(observed);
+			}
+		};
+
+		///Drop the cached buffers of released objects
+		void ProcessReleases()
+		{
+			std::lock_guard<std::mutex> lock(release_mutex);
+			for (PxU32 i = 0; i < released_objects.size(); i++)
+			{
+				const PxBase* observed = released_objects[i];
+
+				std::map<const PxBase*, MeshBuffer*>::iterator it = shape_buffers.find(observed);
+				if (it != shape_buffers.end())
+					ReleaseShapeBuffer(it);
+
+				std::map<const PxBase*, HeightFieldBuffer*>::iterator hf_it = heightfield_buffers.find(observed);
+				if (hf_it != heightfield_buffers.end())
+				{
+					delete hf_it->second;
+					heightfield_buffers.erase(hf_it);
+				}
+
+				std::map<const PxBase*, ClothBuffer*>::iterator cloth_it = cloth_buffers.find(observed);
+				if (cloth_it != cloth_buffers.end())
+				{
+					delete cloth_it->second;
+					cloth_buffers.erase(cloth_it);
+				}
+			}
+			released_objects.clear();
 		}
 
-		void DrawConvexMesh(const PxGeometryHolder& geometry)
+		MeshDeletionListener mesh_deletion_listener;
+
+		///Build the render buffer of a convex mesh (polygons are split into triangle fans)
+		MeshBuffer* BuildConvexMesh(const PxConvexMesh* mesh)
 		{
-			PxConvexMesh* mesh = geometry.convexMesh().convexMesh;
-			PxU32 num_polys = mesh->getNbPolygons();
 			const PxVec3* verts = mesh->getVertices();
-			const PxU8* indicies = mesh->getIndexBuffer();
+			const PxU8* indices = mesh->getIndexBuffer();
+			const PxU32 num_polys = mesh->getNbPolygons();
 
+			std::vector<MeshVertex> data;
 			for (PxU32 i = 0; i < num_polys; i++)
 			{
 				PxHullPolygon face;
-				if (mesh->getPolygonData(i,face))
+				if (!mesh->getPolygonData(i, face))
+					continue;
+
+				PxVec3 n(face.mPlane[0], face.mPlane[1], face.mPlane[2]);
+				const PxU8* face_indices = indices + face.mIndexBase;
+				for (PxU32 j = 2; j < face.mNbVerts; j++)
 				{
-					glBegin(GL_POLYGON);
-					glNormal3f(face.mPlane[0],face.mPlane[1],face.mPlane[2]);
-					const PxU8* faceIdx = indicies + face.mIndexBase;
-					for (PxU32 j = 0; j < face.mNbVerts; j++)
+					PxU32 trig[3] = { face_indices[0], face_indices[j-1], face_indices[j] };
+					for (PxU32 k = 0; k < 3; k++)
 					{
-						PxVec3 v = verts[faceIdx[j]];
-						glVertex3f(v.x,v.y,v.z);
+						MeshVertex vertex;
+						vertex.position = verts[trig[k]];
+						vertex.normal = n;
+						vertex.color = PxVec3(1.f, 1.f, 1.f);
+						data.push_back(vertex);
 					}
-					glEnd();
 				}
 			}
+
+			MeshBuffer* buffer = new MeshBuffer();
+			buffer->nb_verts = (PxU32)data.size();
+			buffer->colored = false;
+			if (data.size())
+				buffer->vertices.Data(&data.front(), data.size()*sizeof(MeshVertex));
+			return buffer;
 		}
 
-		void DrawTriangleMesh(const PxGeometryHolder& geometry)
+		///Build the render buffer of a triangle mesh
+		///The palette (if any) is baked in as per-vertex colours selected by the triangle material index.
+		MeshBuffer* BuildTriangleMesh(const PxTriangleMesh* mesh, const PxVec3* palette)
 		{
-			PxTriangleMesh* mesh = geometry.triangleMesh().triangleMesh;
 			const PxVec3* verts = mesh->getVertices();
-			PxU16* trigs = (PxU16*)mesh->getTriangles();
 			const PxU32 num_trigs = mesh->getNbTriangles();
+			const PxU16* trigs16 = (const PxU16*)mesh->getTriangles();
+			const PxU32* trigs32 = (const PxU32*)mesh->getTriangles();
+			bool has_16bit = (mesh->getTriangleMeshFlags() & PxTriangleMeshFlag::eHAS_16BIT_TRIANGLE_INDICES) ? true : false;
 
-			for (PxU32 i = 0; i < num_trigs*3; i+=3)
+			std::vector<MeshVertex> data(num_trigs*3);
+			for (PxU32 i = 0; i < num_trigs; i++)
 			{
-				PxVec3 v0 = verts[trigs[i]];
-				PxVec3 v1 = verts[trigs[i+1]];
-				PxVec3 v2 = verts[trigs[i+2]];
-				PxVec3 n = (v1-v0).cross(v2-v0);
+				PxVec3 v[3];
+				for (PxU32 j = 0; j < 3; j++)
+					v[j] = verts[has_16bit ? trigs16[i*3+j] : trigs32[i*3+j]];
+
+				PxVec3 n = (v[1]-v[0]).cross(v[2]-v[0]);
 				n.normalize();
-				glBegin(GL_POLYGON);
-				glNormal3f(n.x, n.y, n.z);
-				glVertex3f(v0.x, v0.y, v0.z);
-				glVertex3f(v1.x, v1.y, v1.z);
-				glVertex3f(v2.x, v2.y, v2.z);
-				glEnd();
+
+				PxVec3 color(1.f, 1.f, 1.f);
+				PxU16 material_index = mesh->getTriangleMaterialIndex(i);
+				if (palette && (material_index != 0xffff))
+					color = palette[material_index];
+
+				for (PxU32 j = 0; j < 3; j++)
+				{
+					data[i*3+j].position = v[j];
+					data[i*3+j].normal = n;
+					data[i*3+j].color = color;
+				}
+			}
+
+			MeshBuffer* buffer = new MeshBuffer();
+			buffer->nb_verts = (PxU32)data.size();
+			buffer->colored = (palette != 0);
+			if (data.size())
+				buffer->vertices.Data(&data.front(), data.size()*sizeof(MeshVertex));
+			return buffer;
+		}
+
+		///Get the cached buffer of a mesh shape (built when the mesh is drawn for the first time)
+		///The palette of the first shape is baked into the buffer of a triangle mesh.
+		MeshBuffer* GetMeshBuffer(const PxShape* shape, const PxGeometryHolder& geometry, const PxVec3* palette)
+		{
+			bool convex = (geometry.getType() == PxGeometryType::eCONVEXMESH);
+			const PxBase* mesh = convex ? (const PxBase*)geometry.convexMesh().convexMesh : (const PxBase*)geometry.triangleMesh().triangleMesh;
+
+			std::map<const PxBase*, MeshBuffer*>::iterator it = shape_buffers.find(shape);
+			if (it != shape_buffers.end())
+			{
+				if (it->second->mesh == mesh)
+					return it->second;
+				//the geometry of the shape has changed
+				ReleaseShapeBuffer(it);
+			}
+
+			MeshBuffer*& buffer = mesh_buffers[mesh];
+			if (!buffer)
+			{
+				if (convex)
+					buffer = BuildConvexMesh((const PxConvexMesh*)mesh);
+				else
+					buffer = BuildTriangleMesh((const PxTriangleMesh*)mesh, palette);
+				buffer->mesh = mesh;
+				buffer->references = 0;
+			}
+
+			buffer->references++;
+			shape_buffers[shape] = buffer;
+			return buffer;
+		}
+
+		///Draw a cached mesh buffer with a single call
+		void DrawMeshBuffer(MeshBuffer* buffer, const PxVec3* palette)
+		{
+			if (!buffer->nb_verts)
+				return;
+
+			const char* base = buffer->vertices.Bind();
+
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_NORMAL_ARRAY);
+			glVertexPointer(3, GL_FLOAT, sizeof(MeshVertex), base + offsetof(MeshVertex, position));
+			glNormalPointer(GL_FLOAT, sizeof(MeshVertex), base + offsetof(MeshVertex, normal));
+
+			//per triangle colours are only used in the lit pass (not for shadows)
+			bool colored = palette && buffer->colored;
+			if (colored)
+			{
+				glEnableClientState(GL_COLOR_ARRAY);
+				glColorPointer(3, GL_FLOAT, sizeof(MeshVertex), base + offsetof(MeshVertex, color));
+			}
+
+			glDrawArrays(GL_TRIANGLES, 0, buffer->nb_verts);
+
+			if (colored)
+				glDisableClientState(GL_COLOR_ARRAY);
+			glDisableClientState(GL_NORMAL_ARRAY);
+			glDisableClientState(GL_VERTEX_ARRAY);
+
+			VertexBuffer::Unbind();
+		}
+
+		void DrawConvexMesh(const PxGeometryHolder& geometry, const PxShape* shape)
+		{
+			DrawMeshBuffer(GetMeshBuffer(shape, geometry, 0), 0);
+		}
+
+		void DrawTriangleMesh(const PxGeometryHolder& geometry, const PxShape* shape, const PxVec3* palette)
+		{
+			DrawMeshBuffer(GetMeshBuffer(shape, geometry, palette), palette);
+		}
+
+		///Build the render buffers of a height field
+		///Normals are smoothed over the neighbouring samples, holes are left out.
+		HeightFieldBuffer* BuildHeightField(const PxHeightFieldGeometry& geometry)
+		{
+			const PxHeightField* height_field = geometry.heightField;
+			const PxU32 rows = height_field->getNbRows();
+			const PxU32 columns = height_field->getNbColumns();
+
+			std::vector<PxHeightFieldSample> samples(rows*columns);
+			height_field->saveCells(&samples.front(), (PxU32)(samples.size()*sizeof(PxHeightFieldSample)));
+
+			std::vector<HeightFieldVertex> verts(rows*columns);
+			for (PxU32 r = 0; r < rows; r++)
+				for (PxU32 c = 0; c < columns; c++)
+					verts[r*columns + c].position = PxVec3(r*geometry.rowScale, samples[r*columns + c].height*geometry.heightScale, c*geometry.columnScale);
+
+			for (PxU32 r = 0; r < rows; r++)
+			{
+				for (PxU32 c = 0; c < columns; c++)
+				{
+					PxU32 r0 = r ? (r - 1) : r, r1 = (r + 1 < rows) ? (r + 1) : r;
+					PxU32 c0 = c ? (c - 1) : c, c1 = (c + 1 < columns) ? (c + 1) : c;
+					PxVec3 along_rows = verts[r1*columns + c].position - verts[r0*columns + c].position;
+					PxVec3 along_columns = verts[r*columns + c1].position - verts[r*columns + c0].position;
+					PxVec3 n = along_columns.cross(along_rows);
+					n.normalize();
+					verts[r*columns + c].normal = n;
+				}
+			}
+
+			HeightFieldBuffer* buffer = new HeightFieldBuffer();
+			buffer->height_scale = geometry.heightScale;
+			buffer->row_scale = geometry.rowScale;
+			buffer->column_scale = geometry.columnScale;
+
+			std::vector<PxU32> indices;
+			indices.reserve((rows - 1)*(columns - 1)*6);
+			for (PxU32 chunk_row = 0; chunk_row + 1 < rows; chunk_row += HEIGHTFIELD_CHUNK)
+			{
+				for (PxU32 chunk_column = 0; chunk_column + 1 < columns; chunk_column += HEIGHTFIELD_CHUNK)
+				{
+					HeightFieldChunk chunk;
+					chunk.first_index = (PxU32)indices.size();
+					chunk.bounds = PxBounds3::empty();
+
+					PxU32 last_row = PxMin(chunk_row + HEIGHTFIELD_CHUNK, rows - 1);
+					PxU32 last_column = PxMin(chunk_column + HEIGHTFIELD_CHUNK, columns - 1);
+					for (PxU32 r = chunk_row; r < last_row; r++)
+					{
+						for (PxU32 c = chunk_column; c < last_column; c++)
+						{
+							const PxHeightFieldSample& sample = samples[r*columns + c];
+							PxU32 v0 = r*columns + c, v1 = v0 + 1, v2 = v0 + columns, v3 = v2 + 1;
+							PxU32 cell[6];
+							//the tessellation flag selects the diagonal of the cell
+							if (sample.tessFlag())
+							{
+								PxU32 trigs[6] = { v0, v1, v3, v0, v3, v2 };
+								memcpy(cell, trigs, sizeof(cell));
+							}
+							else
+							{
+								PxU32 trigs[6] = { v2, v0, v1, v2, v1, v3 };
+								memcpy(cell, trigs, sizeof(cell));
+							}
+
+							if (sample.materialIndex0 != PxHeightFieldMaterial::eHOLE)
+								indices.insert(indices.end(), cell, cell + 3);
+							if (sample.materialIndex1 != PxHeightFieldMaterial::eHOLE)
+								indices.insert(indices.end(), cell + 3, cell + 6);
+
+							for (PxU32 i = 0; i < 6; i++)
+								chunk.bounds.include(verts[cell[i]].position);
+						}
+					}
+
+					chunk.nb_indices = (PxU32)indices.size() - chunk.first_index;
+					if (chunk.nb_indices)
+						buffer->chunks.push_back(chunk);
+				}
 			}
+
+			buffer->vertices.Data(&verts.front(), verts.size()*sizeof(HeightFieldVertex));
+			if (indices.size())
+				buffer->indices.Data(&indices.front(), indices.size()*sizeof(PxU32));
+			return buffer;
 		}
 
 		void DrawHeightField(const PxGeometryHolder& geometry)
 		{
-			//TODO
+			const PxHeightFieldGeometry& height_field = geometry.heightField();
+
+			HeightFieldBuffer*& buffer = heightfield_buffers[height_field.heightField];
+			//the same height field can be shared by shapes with different scales
+			if (buffer && ((buffer->height_scale != height_field.heightScale) || (buffer->row_scale != height_field.rowScale) ||
+				(buffer->column_scale != height_field.columnScale)))
+			{
+				delete buffer;
+				buffer = 0;
+			}
+			if (!buffer)
+				buffer = BuildHeightField(height_field);
+
+			//the frustum in the height field frame
+			PxMat44 projection, modelview;
+			glGetFloatv(GL_PROJECTION_MATRIX, (float*)&projection);
+			glGetFloatv(GL_MODELVIEW_MATRIX, (float*)&modelview);
+			Frustum frustum(projection * modelview);
+
+			const char* vertex_base = buffer->vertices.Bind();
+
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_NORMAL_ARRAY);
+			glVertexPointer(3, GL_FLOAT, sizeof(HeightFieldVertex), vertex_base + offsetof(HeightFieldVertex, position));
+			glNormalPointer(GL_FLOAT, sizeof(HeightFieldVertex), vertex_base + offsetof(HeightFieldVertex, normal));
+
+			const char* index_base = buffer->indices.Bind();
+			for (PxU32 i = 0; i < buffer->chunks.size(); i++)
+			{
+				const HeightFieldChunk& chunk = buffer->chunks[i];
+				if (frustum.Visible(chunk.bounds))
+					glDrawElements(GL_TRIANGLES, chunk.nb_indices, GL_UNSIGNED_INT, index_base + chunk.first_index*sizeof(PxU32));
+			}
+
+			glDisableClientState(GL_NORMAL_ARRAY);
+			glDisableClientState(GL_VERTEX_ARRAY);
+
+			VertexBuffer::Unbind(GL_ELEMENT_ARRAY_BUFFER);
+			VertexBuffer::Unbind();
+		}
+
+		///Unit mesh vertex of the batched primitives
+		///Capsule vertices are moved along x by the half height towards their end (+1 or -1).
+		struct TemplateVertex
+		{
+			PxVec3 position;
+			PxVec3 normal;
+			PxReal end;
+		};
+
+		///A primitive shape to draw: world pose, scale of the unit mesh and colour
+		struct Instance
+		{
+			PxMat44 world;
+			PxVec3 scale;
+			PxReal half_height;
+			PxVec3 color;
+		};
+
+		enum BatchType
+		{
+			BATCH_BOX,
+			BATCH_SPHERE,
+			BATCH_CAPSULE,
+			BATCH_TYPES
+		};
+
+		///Detail levels of spheres and capsules, level 0 uses the full render detail
+		static const PxU32 LOD_LEVELS = 4;
+		static const int LOD_MIN_DETAIL = 6;
+		///Length in pixels of a tessellation segment on screen
+		static const PxReal LOD_SEGMENT_PIXELS = 6.f;
+
+		///A unit mesh and its instances of the current frame
+		///Instanced drawing keeps the unit mesh in a static buffer and draws the range of the batch instances,
+		///the fallback draws the range of the expanded vertices.
+		struct Batch
+		{
+			std::vector<TemplateVertex> unit;
+			std::vector<Instance> instances;
+			VertexBuffer* unit_buffer;
+			PxU32 first, count;
+		};
+
+		//boxes only use the first level
+		Batch batches[BATCH_TYPES][LOD_LEVELS];
+		int batch_detail = 0;
+		std::vector<MeshVertex> batch_verts;
+		VertexBuffer* batch_buffer = 0;
+
+		///instanced drawing: 0 until checked, then 1 if supported and -1 for the CPU expansion fallback
+		int instancing = 0;
+		InstanceProgram* instance_program = 0;
+		//the unit buffers hold the templates of the current detail
+		bool units_uploaded = false;
+		std::vector<Instance> batch_instances;
+		VertexBuffer* instance_buffer = 0;
+
+		void BuildBoxTemplate(std::vector<TemplateVertex>& verts)
+		{
+			static const PxReal corners[6][2] = { {-1.f,-1.f}, {1.f,-1.f}, {1.f,1.f}, {-1.f,-1.f}, {1.f,1.f}, {-1.f,1.f} };
+
+			verts.clear();
+			for (PxU32 axis = 0; axis < 3; axis++)
+			{
+				for (PxU32 side = 0; side < 2; side++)
+				{
+					for (PxU32 i = 0; i < 6; i++)
+					{
+						TemplateVertex vertex;
+						vertex.normal = PxVec3(0.f, 0.f, 0.f);
+						vertex.normal[axis] = side ? 1.f : -1.f;
+						vertex.position = vertex.normal;
+						vertex.position[(axis+1)%3] = corners[i][0];
+						vertex.position[(axis+2)%3] = corners[i][1];
+						vertex.end = 0.f;
+						verts.push_back(vertex);
+					}
+				}
+			}
+		}
+
+		///Point of the unit sphere with the poles on the x axis
+		PxVec3 SpherePoint(PxU32 stack, PxU32 slice, PxU32 stacks, PxU32 slices)
+		{
+			PxReal theta = PxPi*stack/stacks;
+			PxReal phi = 2.f*PxPi*slice/slices;
+			return PxVec3(PxCos(theta), PxSin(theta)*PxCos(phi), PxSin(theta)*PxSin(phi));
+		}
+
+		///Unit sphere, or a capsule when the two halves are split by a cylinder
+		void BuildSphereTemplate(std::vector<TemplateVertex>& verts, PxU32 detail, bool capsule)
+		{
+			//an even number of stacks puts a ring on the equator
+			PxU32 stacks = PxMax(detail + (detail & 1), (PxU32)2);
+			PxU32 slices = PxMax(detail, (PxU32)3);
+
+			verts.clear();
+			for (PxU32 stack = 0; stack < stacks; stack++)
+			{
+				PxReal end = capsule ? ((stack < stacks/2) ? 1.f : -1.f) : 0.f;
+				for (PxU32 slice = 0; slice < slices; slice++)
+				{
+					PxVec3 quad[4] = { SpherePoint(stack, slice, stacks, slices), SpherePoint(stack+1, slice, stacks, slices),
+						SpherePoint(stack+1, slice+1, stacks, slices), SpherePoint(stack, slice+1, stacks, slices) };
+					static const PxU32 trigs[6] = { 0, 1, 2, 0, 2, 3 };
+					for (PxU32 i = 0; i < 6; i++)
+					{
+						TemplateVertex vertex;
+						vertex.position = vertex.normal = quad[trigs[i]];
+						vertex.end = end;
+						verts.push_back(vertex);
+					}
+				}
+			}
+
+			if (capsule)
+			{
+				for (PxU32 slice = 0; slice < slices; slice++)
+				{
+					PxVec3 p0 = SpherePoint(stacks/2, slice, stacks, slices);
+					PxVec3 p1 = SpherePoint(stacks/2, slice+1, stacks, slices);
+					TemplateVertex quad[4] = { { p0, p0, 1.f }, { p0, p0, -1.f }, { p1, p1, -1.f }, { p1, p1, 1.f } };
+					static const PxU32 trigs[6] = { 0, 1, 2, 0, 2, 3 };
+					for (PxU32 i = 0; i < 6; i++)
+						verts.push_back(quad[trigs[i]]);
+				}
+			}
+		}
+
+		int LevelDetail(PxU32 level)
+		{
+			return PxMax(render_detail >> level, LOD_MIN_DETAIL);
+		}
+
+		///Select the coarsest level that keeps the tessellation segments below the target size on screen
+		PxU32 SelectLevel(const PxVec3& position, PxReal radius)
+		{
+			PxReal distance = PxMax((position - camera_eye).magnitude(), camera_near);
+			PxReal segments = 2.f*PxPi*radius*pixel_scale / (distance*LOD_SEGMENT_PIXELS);
+			for (PxU32 level = LOD_LEVELS - 1; level > 0; level--)
+				if (LevelDetail(level) >= segments)
+					return level;
+			return 0;
+		}
+
+		///Queue a box, sphere or capsule for batched drawing (false for other geometry types)
+		bool AddInstance(const PxGeometryHolder& geometry, const PxMat44& world, const PxVec3& color)
+		{
+			Instance instance;
+			instance.world = world;
+			instance.half_height = 0.f;
+			instance.color = color;
+
+			switch (geometry.getType())
+			{
+			case PxGeometryType::eBOX:
+				instance.scale = geometry.box().halfExtents;
+				batches[BATCH_BOX][0].instances.push_back(instance);
+				return true;
+			case PxGeometryType::eSPHERE:
+				instance.scale = PxVec3(geometry.sphere().radius);
+				batches[BATCH_SPHERE][SelectLevel(world.getPosition(), geometry.sphere().radius)].instances.push_back(instance);
+				return true;
+			case PxGeometryType::eCAPSULE:
+				instance.scale = PxVec3(geometry.capsule().radius);
+				instance.half_height = geometry.capsule().halfHeight;
+				batches[BATCH_CAPSULE][SelectLevel(world.getPosition(), geometry.capsule().radius)].instances.push_back(instance);
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		///Expand the unit mesh for all instances of a batch into the batch vertices
+		void ExpandInstances(Batch& batch)
+		{
+			const std::vector<TemplateVertex>& unit = batch.unit;
+			const std::vector<Instance>& instances = batch.instances;
+			batch.first = (PxU32)batch_verts.size();
+			batch.count = (PxU32)(unit.size()*instances.size());
+			if (!batch.count)
+				return;
+
+			size_t base = batch_verts.size();
+			batch_verts.resize(base + batch.count);
+			MeshVertex* vertex = &batch_verts[base];
+			for (PxU32 i = 0; i < instances.size(); i++)
+			{
+				const Instance& instance = instances[i];
+				for (PxU32 j = 0; j < unit.size(); j++, vertex++)
+				{
+					PxVec3 local = unit[j].position.multiply(instance.scale);
+					local.x += unit[j].end*instance.half_height;
+					vertex->position = instance.world.transform(local);
+					vertex->normal = instance.world.rotate(unit[j].normal);
+					vertex->color = instance.color;
+				}
+			}
+		}
+
+		///Draw a range of the batch vertices for every batch with instances
+		void DrawBatchRanges()
+		{
+			for (PxU32 i = 0; i < BATCH_TYPES; i++)
+				for (PxU32 level = 0; level < LOD_LEVELS; level++)
+					if (batches[i][level].count)
+						glDrawArrays(GL_TRIANGLES, batches[i][level].first, batches[i][level].count);
+		}
+
+		///Check once if the instance program can be used (needs a current GL context)
+		bool InstancingSupported()
+		{
+			if (!instancing)
+			{
+				instancing = -1;
+				if (VertexBuffer::Supported() && InstanceProgram::Supported())
+				{
+					instance_program = new InstanceProgram();
+					if (instance_program->Create())
+						instancing = 1;
+					else
+					{
+						delete instance_program;
+						instance_program = 0;
+					}
+				}
+			}
+			return instancing > 0;
+		}
+
+		///Draw the instance range of every batch with its unit mesh
+		void DrawInstanceRanges(const char* instance_base)
+		{
+			for (PxU32 i = 0; i < BATCH_TYPES; i++)
+			{
+				for (PxU32 level = 0; level < LOD_LEVELS; level++)
+				{
+					Batch& batch = batches[i][level];
+					if (!batch.count)
+						continue;
+
+					const char* unit_base = batch.unit_buffer->Bind();
+					instance_program->Pointer(InstanceProgram::POSITION, 3, sizeof(TemplateVertex), unit_base + offsetof(TemplateVertex, position));
+					instance_program->Pointer(InstanceProgram::NORMAL, 3, sizeof(TemplateVertex), unit_base + offsetof(TemplateVertex, normal));
+					instance_program->Pointer(InstanceProgram::END, 1, sizeof(TemplateVertex), unit_base + offsetof(TemplateVertex, end));
+
+					instance_buffer->Bind();
+					const char* base = instance_base + batch.first*sizeof(Instance);
+					for (PxU32 column = 0; column < 4; column++)
+						instance_program->Pointer((InstanceProgram::Attribute)(InstanceProgram::WORLD + column), 4, sizeof(Instance),
+							base + offsetof(Instance, world) + column*sizeof(PxVec4), true);
+					//scale and half height are adjacent and go in as one vec4
+					instance_program->Pointer(InstanceProgram::SCALE, 4, sizeof(Instance), base + offsetof(Instance, scale), true);
+					instance_program->Pointer(InstanceProgram::COLOR, 3, sizeof(Instance), base + offsetof(Instance, color), true);
+
+					instance_program->Draw((GLsizei)batch.unit.size(), (GLsizei)batch.count);
+				}
+			}
+		}
+
+		///Draw the queued instances from the static unit meshes, only the instance data is streamed each frame
+		void DrawInstanced(const PxVec3& shadow_color)
+		{
+			if (!units_uploaded)
+			{
+				for (PxU32 i = 0; i < BATCH_TYPES; i++)
+				{
+					for (PxU32 level = 0; level < LOD_LEVELS; level++)
+					{
+						Batch& batch = batches[i][level];
+						if (!batch.unit.size())
+							continue;
+						if (!batch.unit_buffer)
+							batch.unit_buffer = new VertexBuffer();
+						batch.unit_buffer->Data(&batch.unit.front(), batch.unit.size()*sizeof(TemplateVertex));
+					}
+				}
+				units_uploaded = true;
+			}
+
+			batch_instances.clear();
+			for (PxU32 i = 0; i < BATCH_TYPES; i++)
+			{
+				for (PxU32 level = 0; level < LOD_LEVELS; level++)
+				{
+					Batch& batch = batches[i][level];
+					batch.first = (PxU32)batch_instances.size();
+					batch.count = (PxU32)batch.instances.size();
+					batch_instances.insert(batch_instances.end(), batch.instances.begin(), batch.instances.end());
+					batch.instances.clear();
+				}
+			}
+
+			if (!batch_instances.size())
+				return;
+
+			if (!instance_buffer)
+				instance_buffer = new VertexBuffer();
+			instance_buffer->Data(&batch_instances.front(), batch_instances.size()*sizeof(Instance), GL_STREAM_DRAW);
+
+			const char* instance_base = instance_buffer->Bind();
+			instance_program->Begin(true);
+			DrawInstanceRanges(instance_base);
+
+			if (show_shadows)
+			{
+				glPushMatrix();
+				glMultMatrixf(shadow_matrix);
+				GLfloat color[] = { shadow_color.x, shadow_color.y, shadow_color.z };
+				instance_program->Begin(false, color);
+				DrawInstanceRanges(instance_base);
+				glPopMatrix();
+			}
+
+			instance_program->End();
+			VertexBuffer::Unbind();
+		}
+
+		///Draw all queued primitives (and their shadows) with one call per type and detail level
+		void DrawBatches(const PxVec3& shadow_color)
+		{
+			if (batch_detail != render_detail)
+			{
+				BuildBoxTemplate(batches[BATCH_BOX][0].unit);
+				for (PxU32 level = 0; level < LOD_LEVELS; level++)
+				{
+					BuildSphereTemplate(batches[BATCH_SPHERE][level].unit, LevelDetail(level), false);
+					BuildSphereTemplate(batches[BATCH_CAPSULE][level].unit, LevelDetail(level), true);
+				}
+				batch_detail = render_detail;
+				units_uploaded = false;
+			}
+
+			if (InstancingSupported())
+			{
+				DrawInstanced(shadow_color);
+				return;
+			}
+
+			//fallback: every vertex of every instance is transformed here and streamed
+			batch_verts.clear();
+			for (PxU32 i = 0; i < BATCH_TYPES; i++)
+			{
+				for (PxU32 level = 0; level < LOD_LEVELS; level++)
+				{
+					ExpandInstances(batches[i][level]);
+					batches[i][level].instances.clear();
+				}
+			}
+
+			if (!batch_verts.size())
+				return;
+
+			if (!batch_buffer)
+				batch_buffer = new VertexBuffer();
+			batch_buffer->Data(&batch_verts.front(), batch_verts.size()*sizeof(MeshVertex), GL_STREAM_DRAW);
+			const char* base = batch_buffer->Bind();
+
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_NORMAL_ARRAY);
+			glEnableClientState(GL_COLOR_ARRAY);
+			glVertexPointer(3, GL_FLOAT, sizeof(MeshVertex), base + offsetof(MeshVertex, position));
+			glNormalPointer(GL_FLOAT, sizeof(MeshVertex), base + offsetof(MeshVertex, normal));
+			glColorPointer(3, GL_FLOAT, sizeof(MeshVertex), base + offsetof(MeshVertex, color));
+
+			DrawBatchRanges();
+
+			glDisableClientState(GL_COLOR_ARRAY);
+
+			if (show_shadows)
+			{
+				glPushMatrix();
+				glMultMatrixf(shadow_matrix);
+				glDisable(GL_LIGHTING);
+				glColor4f(shadow_color.x, shadow_color.y, shadow_color.z, 1.f);
+				DrawBatchRanges();
+				glEnable(GL_LIGHTING);
+				glPopMatrix();
+			}
+
+			glDisableClientState(GL_NORMAL_ARRAY);
+			glDisableClientState(GL_VERTEX_ARRAY);
+
+			VertexBuffer::Unbind();
 		}
 
-		void RenderGeometry(const PxGeometryHolder& geometry)
+		void RenderGeometry(const PxGeometryHolder& geometry, const PxShape* shape, const PxVec3* palette=0)
 		{
 			switch(geometry.getType())
 			{
 			case PxGeometryType::ePLANE:
 				DrawPlane();
 				break;
-			case PxGeometryType::eSPHERE:
-				DrawSphere(geometry);
-				break;
-			case PxGeometryType::eBOX:			
-				DrawBox(geometry);
-				break;
-			case PxGeometryType::eCAPSULE:
-				DrawCapsule(geometry);
-				break;
 			case PxGeometryType::eCONVEXMESH:
-				DrawConvexMesh(geometry);
+				DrawConvexMesh(geometry, shape);
 				break;
 			case PxGeometryType::eTRIANGLEMESH:
-				DrawTriangleMesh(geometry);
+				DrawTriangleMesh(geometry, shape, palette);
 				break;
 			case PxGeometryType::eHEIGHTFIELD:
 				DrawHeightField(geometry);
@@ -156,49 +985,88 @@ namespace VisualDebugger
 			}
 		}
 
-		void RenderCloth(const PxCloth* cloth)
+		///Accumulate the quad normals on their vertices and normalize them
+		///Particles and normals are both 16 byte vectors, so each one fits a single SSE register.
+		void ComputeClothNormals(const PxClothParticle* particles, PxU32 nb_particles, const PxU32* quads, PxU32 nb_quads, PxVec4* normals)
 		{
-			PxClothMeshDesc* mesh_desc = ((UserData*)cloth->userData)->cloth_mesh_desc;
-			PxVec3* color = ((UserData*)cloth->userData)->color;
-
-			PxU32 quad_count = mesh_desc->quads.count;
-			PxU32* quads = (PxU32*)mesh_desc->quads.data;
+			std::fill(normals, normals + nb_particles, PxVec4(0.f, 0.f, 0.f, 0.f));
 
-			std::vector<PxVec3> verts(cloth->getNbParticles());
-			std::vector<PxVec3> norms(verts.size(), PxVec3(0.f,0.f,0.f));
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+			for (PxU32 i = 0; i < nb_quads*4; i += 4)
+			{
+				__m128 v0 = _mm_loadu_ps(&particles[quads[i]].pos.x);
+				__m128 e1 = _mm_sub_ps(_mm_loadu_ps(&particles[quads[i+1]].pos.x), v0);
+				__m128 e2 = _mm_sub_ps(_mm_loadu_ps(&particles[quads[i+2]].pos.x), v0);
 
-			//get verts data
-			cloth->lockParticleData();
+				//n = e2 x e1 (w cancels out to 0)
+				__m128 n = _mm_sub_ps(
+					_mm_mul_ps(_mm_shuffle_ps(e2, e2, _MM_SHUFFLE(3,0,2,1)), _mm_shuffle_ps(e1, e1, _MM_SHUFFLE(3,1,0,2))),
+					_mm_mul_ps(_mm_shuffle_ps(e2, e2, _MM_SHUFFLE(3,1,0,2)), _mm_shuffle_ps(e1, e1, _MM_SHUFFLE(3,0,2,1))));
 
-			PxClothParticleData* particle_data = cloth->lockParticleData();
-			if (!particle_data)
-				return;
-			// copy vertex positions
-			for (PxU32 j = 0; j < verts.size(); j++)
-				verts[j] = particle_data->particles[j].pos;
+				for (PxU32 j = 0; j < 4; j++)
+				{
+					float* normal = &normals[quads[i+j]].x;
+					_mm_storeu_ps(normal, _mm_add_ps(_mm_loadu_ps(normal), n));
+				}
+			}
 
-			particle_data->unlock();
+			const __m128 half = _mm_set1_ps(.5f);
+			const __m128 three = _mm_set1_ps(3.f);
+			for (PxU32 i = 0; i < nb_particles; i++)
+			{
+				float* normal = &normals[i].x;
+				__m128 n = _mm_loadu_ps(normal);
+				__m128 sq = _mm_mul_ps(n, n);
+				__m128 length2 = _mm_add_ps(_mm_add_ps(_mm_shuffle_ps(sq, sq, _MM_SHUFFLE(0,0,0,0)), _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1,1,1,1))),
+					_mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2,2,2,2)));
+				if (_mm_cvtss_f32(length2) <= 0.f)
+					continue;
+
+				//reciprocal square root refined with one Newton-Raphson step
+				__m128 r = _mm_rsqrt_ps(length2);
+				r = _mm_mul_ps(_mm_mul_ps(half, r), _mm_sub_ps(three, _mm_mul_ps(_mm_mul_ps(length2, r), r)));
+				_mm_storeu_ps(normal, _mm_mul_ps(n, r));
+			}
+#else
+			for (PxU32 i = 0; i < nb_quads*4; i += 4)
+			{
+				const PxVec3& v0 = particles[quads[i]].pos;
+				PxVec3 n = (particles[quads[i+2]].pos - v0).cross(particles[quads[i+1]].pos - v0);
+				for (PxU32 j = 0; j < 4; j++)
+				{
+					PxVec4& normal = normals[quads[i+j]];
+					normal.x += n.x; normal.y += n.y; normal.z += n.z;
+				}
+			}
 
-			for (PxU32 i = 0; i < quad_count*4; i+=4)
+			for (PxU32 i = 0; i < nb_particles; i++)
 			{
-				PxVec3 v0 = verts[quads[i]];
-				PxVec3 v1 = verts[quads[i+1]];
-				PxVec3 v2 = verts[quads[i+2]];
-				PxVec3 n = -((v1-v0).cross(v2-v0));
+				PxVec3 n = normals[i].getXYZ();
+				n.normalize();
+				normals[i] = PxVec4(n, 0.f);
+			}
+#endif
+		}
 
-				norms[quads[i]] += n;
-				norms[quads[i+1]] += n;
-				norms[quads[i+2]] += n;
-				norms[quads[i+3]] += n;
+		void RenderCloth(const ClothSnapshot& cloth, const PxClothParticle* particles, PxReal alpha)
+		{
+			//the topology is uploaded once
+			ClothBuffer*& buffer = cloth_buffers[cloth.cloth];
+			if (!buffer)
+			{
+				buffer = new ClothBuffer();
+				buffer->quads.Data(cloth.quads, cloth.nb_quads*4*sizeof(PxU32));
 			}
+			buffer->normal_data.resize(cloth.nb_particles);
 
-			for (PxU32 i = 0; i < norms.size(); i++)
-				norms[i].normalize();
+			//positions are streamed straight from the snapshot
+			ComputeClothNormals(particles, cloth.nb_particles, cloth.quads, cloth.nb_quads, &buffer->normal_data.front());
+			buffer->positions.Data(particles, cloth.nb_particles*sizeof(PxClothParticle), GL_STREAM_DRAW);
+			buffer->normals.Data(&buffer->normal_data.front(), cloth.nb_particles*sizeof(PxVec4), GL_STREAM_DRAW);
 
-			PxTransform pose = cloth->getGlobalPose();
-			PxMat44 shapePose(pose);
+			PxMat44 shapePose((alpha < 1.f) ? Interpolate(cloth.previous_pose, cloth.pose, alpha) : cloth.pose);
 
-			glColor4f(color->x, color->y, color->z, 1.f);
+			glColor4f(cloth.color.x, cloth.color.y, cloth.color.z, 1.f);
 
 			glPushMatrix();						
 			glMultMatrixf((float*)&shapePose);
@@ -206,25 +1074,49 @@ namespace VisualDebugger
 			glEnableClientState(GL_VERTEX_ARRAY);
 			glEnableClientState(GL_NORMAL_ARRAY);
 
-			glVertexPointer(3, GL_FLOAT, sizeof(PxVec3), &verts.front());
-			glNormalPointer(GL_FLOAT, sizeof(PxVec3), &norms.front());
+			glVertexPointer(3, GL_FLOAT, sizeof(PxClothParticle), buffer->positions.Bind());
+			glNormalPointer(GL_FLOAT, sizeof(PxVec4), buffer->normals.Bind());
 
-			glDrawElements(GL_QUADS, quad_count*4, GL_UNSIGNED_INT, quads);
+			glDrawElements(GL_QUADS, cloth.nb_quads*4, GL_UNSIGNED_INT, buffer->quads.Bind());
 
 			glDisableClientState(GL_NORMAL_ARRAY);
 			glDisableClientState(GL_VERTEX_ARRAY);
 
+			VertexBuffer::Unbind(GL_ELEMENT_ARRAY_BUFFER);
+			VertexBuffer::Unbind();
+
 			glPopMatrix();
 		}
 
 		void reshapeCallback(int width, int height)
 		{
+			target_width = width;
+			target_height = height;
 			glViewport(0, 0, width, height);
 		}
 
+		///Redraw when the next frame is due, sleep otherwise
 		void idleCallback()
 		{
-			glClearColor(background_color.x, background_color.y, background_color.z, 1.f);
+			PxReal rate = low_power ? LOW_POWER_RATE : frame_rate;
+			Clock::time_point now = Clock::now();
+
+			if ((rate > 0.f) && (now < next_frame))
+			{
+				//sleep in short slices so GLUT keeps handling input events
+				Clock::time_point wake = now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<PxReal>(MAX_IDLE_SLEEP));
+				std::this_thread::sleep_until(std::min(wake, next_frame));
+				return;
+			}
+
+			if (rate > 0.f)
+			{
+				next_frame += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<PxReal>(1.f/rate));
+				//more than a frame behind, start a new cadence instead of catching up
+				if (next_frame < now)
+					next_frame = now;
+			}
+
 			glutPostRedisplay();
 		}
 
@@ -243,9 +1135,130 @@ namespace VisualDebugger
 			glutReshapeFunc(reshapeCallback);
 			glutIdleFunc(idleCallback);
 
+			target_width = width;
+			target_height = height;
+			offscreen = false;
+
 			delete[] namestr;
 		}
 
+		bool InitOffscreen(int width, int height)
+		{
+#ifdef RENDERER_OSMESA
+			//RGBA colour buffer in client memory with a 24 bit depth buffer
+			offscreen_context = OSMesaCreateContextExt(OSMESA_RGBA, 24, 0, 0, 0);
+			if (!offscreen_context)
+				return false;
+
+			offscreen_buffer.resize(width*height*4);
+			if (!OSMesaMakeCurrent(offscreen_context, &offscreen_buffer.front(), GL_UNSIGNED_BYTE, width, height))
+			{
+				OSMesaDestroyContext(offscreen_context);
+				offscreen_context = 0;
+				return false;
+			}
+
+			target_width = width;
+			target_height = height;
+			offscreen = true;
+			glViewport(0, 0, width, height);
+			return true;
+#else
+			return false;
+#endif
+		}
+
+		void Release()
+		{
+#ifdef RENDERER_OSMESA
+			if (offscreen_context)
+			{
+				OSMesaDestroyContext(offscreen_context);
+				offscreen_context = 0;
+			}
+#endif
+		}
+
+		void StartCapture(const char* prefix, bool raw)
+		{
+			StopCapture();
+			frame_capture = new FrameCapture(prefix, target_width, target_height, raw ? FrameCapture::RAW : FrameCapture::PPM);
+		}
+
+		PxU32 StopCapture()
+		{
+			if (!frame_capture)
+				return 0;
+
+			PxU32 frames = frame_capture->Frames();
+			frame_capture->Stop();
+			bool failed = frame_capture->Failed();
+			delete frame_capture;
+			frame_capture = 0;
+
+			if (failed)
+				throw new Exception("Renderer::StopCapture, Could not write all captured frames.");
+
+			return frames;
+		}
+
+		void FrameRate(PxReal value)
+		{
+			frame_rate = value;
+			next_frame = Clock::now();
+		}
+
+		PxReal FrameRate()
+		{
+			return frame_rate;
+		}
+
+		void LowPower(bool value)
+		{
+			//leaving the low rate mode draws the next frame right away
+			if (low_power && !value)
+				next_frame = Clock::now();
+			low_power = value;
+		}
+
+		bool LowPower()
+		{
+			return low_power;
+		}
+
+		bool VSync(bool value)
+		{
+			if (offscreen)
+				return false;
+#ifdef _WIN32
+			typedef BOOL (APIENTRY *SwapIntervalProc)(int interval);
+			SwapIntervalProc swap_interval = (SwapIntervalProc)wglGetProcAddress("wglSwapIntervalEXT");
+			return swap_interval && swap_interval(value ? 1 : 0);
+#else
+			//returns 0 on success
+			typedef int (*SwapIntervalProc)(int interval);
+			SwapIntervalProc swap_interval = (SwapIntervalProc)glXGetProcAddressARB((const GLubyte*)"glXSwapIntervalSGI");
+			return swap_interval && !swap_interval(value ? 1 : 0);
+#endif
+		}
+
+		int Width()
+		{
+			return target_width;
+		}
+
+		int Height()
+		{
+			return target_height;
+		}
+
+		void ReadPixels(std::vector<unsigned char>& pixels)
+		{
+			pixels.resize(target_width*target_height*3);
+			glPixelStorei(GL_PACK_ALIGNMENT, 1);
+			glReadPixels(0, 0, target_width, target_height, GL_RGB, GL_UNSIGNED_BYTE, &pixels.front());
+		}
+
 		void Init()
 		{
 			// Setup default render states
@@ -265,16 +1278,29 @@ namespace VisualDebugger
 			glLightfv(GL_LIGHT0, GL_DIFFUSE, diffuseColor);
 			glLightfv(GL_LIGHT0, GL_POSITION, position);
 			glEnable(GL_LIGHT0);
+
+			//release cached buffers together with their shapes, height fields and cloths
+			PxGetPhysics().registerDeletionListener(mesh_deletion_listener, PxDeletionEventFlag::eMEMORY_RELEASE);
 		}
 
 		void Start(const PxVec3& cameraEye, const PxVec3& cameraDir)
 		{
+			glClearColor(background_color.x, background_color.y, background_color.z, 1.f);
 			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 			// Setup camera
 			glMatrixMode(GL_PROJECTION);
 			glLoadIdentity();
-			gluPerspective(60.f, (float)glutGet(GLUT_WINDOW_WIDTH)/(float)glutGet(GLUT_WINDOW_HEIGHT), 1.f, 10000.f);
+			PxReal aspect = (float)target_width/(float)target_height;
+			gluPerspective(camera_fov, aspect, camera_near, camera_far);
+
+			//view frustum culling
+			view_frustum = Frustum(CameraMatrix(cameraEye, cameraDir, aspect));
+			culled_shapes = 0;
+
+			//level of detail selection
+			camera_eye = cameraEye;
+			pixel_scale = target_height / (2.f*PxTan(camera_fov*PxPi/360.f));
 
 			glMatrixMode(GL_MODELVIEW);
 			glLoadIdentity();
@@ -286,83 +1312,130 @@ namespace VisualDebugger
 			background_color = color;
 		}
 
-		void Render(PxActor** actors, const PxU32 numActors)
+		void Render(const SceneSnapshot& snapshot, PxReal alpha)
 		{
+			ProcessReleases();
+
 			PxVec3 shadow_color = default_color*0.9;
-			for(PxU32 i=0;i<numActors;i++)
+
+			for (PxU32 i = 0; i < snapshot.cloths.size(); i++)
 			{
-				if (actors[i]->isCloth())
+				const ClothSnapshot& cloth = snapshot.cloths[i];
+				if (!cloth.nb_particles)
+					continue;
+				if (Visible(cloth.bounds))
+					RenderCloth(cloth, &snapshot.particles[cloth.first_particle], alpha);
+				else
+					culled_shapes++;
+			}
+
+			for (PxU32 i = 0; i < snapshot.actors.size(); i++)
+			{
+				const ActorSnapshot& actor = snapshot.actors[i];
+
+				//skip whole actors outside of the view first
+				if (!Visible(actor.bounds))
 				{
-					RenderCloth((PxCloth*)actors[i]);
+					culled_shapes += actor.nb_shapes;
+					continue;
 				}
-				else if (actors[i]->isRigidActor())
+
+				for (PxU32 j = actor.first_shape; j < actor.first_shape + actor.nb_shapes; j++)
 				{
-					PxRigidActor* rigid_actor = (PxRigidActor*)actors[i];
-					std::vector<PxShape*> shapes(rigid_actor->getNbShapes());
-					rigid_actor->getShapes((PxShape**)&shapes.front(), (PxU32)shapes.size());
+					const ShapeSnapshot& shape = snapshot.shapes[j];
+					if ((actor.nb_shapes > 1) && !Visible(shape.bounds))
+					{
+						culled_shapes++;
+						continue;
+					}
+
+					const PxGeometryHolder& h = shape.geometry;
+					PxMat44 shapePose;
+					//move the plane slightly down to avoid visual artefacts
+					if (h.getType() == PxGeometryType::ePLANE)
+					{
+						PxTransform pose = shape.pose;
+						pose.q *= PxQuat(PxHalfPi, PxVec3(0.f, 0.f, 1.f));
+						pose.p += PxVec3(0,-0.01,0);
+						shapePose = PxMat44(pose);
+					}
+					//shapes that did not move in the last step use the world matrix of the snapshot
+					else if ((alpha < 1.f) && shape.moved)
+						shapePose = PxMat44(Interpolate(shape.previous_pose, shape.pose, alpha));
+					else
+						shapePose = shape.world;
+
+					PxVec3 shape_color = default_color;
 
-					for(PxU32 j = 0; j < shapes.size(); j++)
+					if (shape.colored)
 					{
-						const PxShape* shape = shapes[j];
-						PxTransform pose = PxShapeExt::getGlobalPose(*shape, *shape->getActor());
-						PxGeometryHolder h = shape->getGeometry();
-						//move the plane slightly down to avoid visual artefacts
+						shape_color = shape.color;
 						if (h.getType() == PxGeometryType::ePLANE)
 						{
-							pose.q *= PxQuat(PxHalfPi, PxVec3(0.f, 0.f, 1.f));
-							pose.p += PxVec3(0,-0.01,0);
+							shadow_color = shape_color*0.9;
 						}
+					}
 
-						PxMat44 shapePose(pose);
-						// render object
-						glPushMatrix();						
-						glMultMatrixf((float*)&shapePose);
+					//boxes, spheres and capsules are drawn in batches after all actors
+					if (AddInstance(h, shapePose, shape_color))
+						continue;
 
-						PxVec3 shape_color = default_color;
+					// render object
+					glPushMatrix();						
+					glMultMatrixf((float*)&shapePose);
 
-						if (shape->userData)
-						{
-							shape_color = *(((UserData*)shape->userData)->color);
-							if (h.getType() == PxGeometryType::ePLANE)
-							{
-								shadow_color = shape_color*0.9;
-							}
-						}
+					if (h.getType() == PxGeometryType::ePLANE)
+						glDisable(GL_LIGHTING);
 
-						if (h.getType() == PxGeometryType::ePLANE)
-							glDisable(GL_LIGHTING);
+					glColor4f(shape_color.x, shape_color.y, shape_color.z, 1.f);
 
-						glColor4f(shape_color.x, shape_color.y, shape_color.z, 1.f);
+					RenderGeometry(h, shape.shape, shape.palette);
 
-						RenderGeometry(h);
+					if (h.getType() == PxGeometryType::ePLANE)
+						glEnable(GL_LIGHTING);
 
-						if (h.getType() == PxGeometryType::ePLANE)
-							glEnable(GL_LIGHTING);
+					glPopMatrix();
 
+					//the ground (planes and height fields) does not cast shadows
+					if(show_shadows && (h.getType() != PxGeometryType::ePLANE) && (h.getType() != PxGeometryType::eHEIGHTFIELD))
+					{
+						glPushMatrix();						
+						glMultMatrixf(shadow_matrix);
+						glMultMatrixf((float*)&shapePose);
+						glDisable(GL_LIGHTING);
+						glColor4f(shadow_color.x, shadow_color.y, shadow_color.z, 1.f);
+						RenderGeometry(h, shape.shape);
+						glEnable(GL_LIGHTING);
 						glPopMatrix();
-
-						if(show_shadows && (h.getType() != PxGeometryType::ePLANE))
-						{
-							const PxVec3 shadowDir(-0.7071067f, -0.7071067f, -0.7071067f);
-							const PxReal shadowMat[]={ 1,0,0,0, -shadowDir.x/shadowDir.y,0,-shadowDir.z/shadowDir.y,0, 0,0,1,0, 0,0,0,1 };
-							glPushMatrix();						
-							glMultMatrixf(shadowMat);
-							glMultMatrixf((float*)&shapePose);
-							glDisable(GL_LIGHTING);
-							glColor4f(shadow_color.x, shadow_color.y, shadow_color.z, 1.f);
-							RenderGeometry(h);
-							glEnable(GL_LIGHTING);
-							glPopMatrix();
-						}
 					}
 				}
-
 			}
+
+			DrawBatches(shadow_color);
+		}
+
+		///snapshot used to render live actors
+		SceneSnapshot actor_snapshot;
+
+		void Render(PxActor** actors, const PxU32 numActors)
+		{
+			TakeSnapshot(actors, numActors, actor_snapshot);
+			Render(actor_snapshot);
 		}
 
 		void Finish()
 		{
-			glutSwapBuffers();
+			//all text of the frame goes out in one batch
+			GLFontRenderer::flush();
+
+			if (frame_capture)
+				frame_capture->Capture();
+
+			//the offscreen buffer is single buffered, make sure the frame is complete before it is read
+			if (offscreen)
+				glFinish();
+			else
+				glutSwapBuffers();
 		}
 
 		void SetRenderDetail(int value)
@@ -377,13 +1450,68 @@ namespace VisualDebugger
 
 		bool ShowShadows() { return show_shadows; }
 
-		void RenderBuffer(float* pVertList, float* pColorList, int type, int num)
+		PxU32 CulledShapes() { return culled_shapes; }
+
+		///Vertex layout shared by the debug points, lines and triangles of PhysX
+		struct DebugVertex
+		{
+			PxVec3 pos;
+			PxU32 color;
+		};
+
+		PX_COMPILE_TIME_ASSERT(sizeof(PxDebugPoint) == sizeof(DebugVertex));
+		PX_COMPILE_TIME_ASSERT(sizeof(PxDebugLine) == 2*sizeof(DebugVertex));
+		PX_COMPILE_TIME_ASSERT(sizeof(PxDebugTriangle) == 3*sizeof(DebugVertex));
+
+		//debug colours converted for GL, kept between frames
+		std::vector<PxU32> debug_colors;
+
+		///Convert packed ARGB debug colours to opaque RGBA bytes
+		void ConvertColors(const DebugVertex* verts, PxU32 count, PxU32* colors)
 		{
+			PxU32 i = 0;
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+			const __m128i red_blue = _mm_set1_epi32(0x00ff00ff);
+			const __m128i green = _mm_set1_epi32(0x0000ff00);
+			const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+			for (; i + 4 <= count; i += 4)
+			{
+				//gather the colours of four vertices
+				__m128i v0 = _mm_loadu_si128((const __m128i*)&verts[i]);
+				__m128i v1 = _mm_loadu_si128((const __m128i*)&verts[i+1]);
+				__m128i v2 = _mm_loadu_si128((const __m128i*)&verts[i+2]);
+				__m128i v3 = _mm_loadu_si128((const __m128i*)&verts[i+3]);
+				__m128i c = _mm_unpackhi_epi64(_mm_unpackhi_epi32(v0, v1), _mm_unpackhi_epi32(v2, v3));
+
+				//swap red and blue, keep green and set alpha
+				__m128i rb = _mm_and_si128(c, red_blue);
+				rb = _mm_or_si128(_mm_srli_epi32(rb, 16), _mm_slli_epi32(rb, 16));
+				c = _mm_or_si128(_mm_or_si128(rb, _mm_and_si128(c, green)), alpha);
+				_mm_storeu_si128((__m128i*)&colors[i], c);
+			}
+#endif
+			for (; i < count; i++)
+			{
+				PxU32 c = verts[i].color;
+				colors[i] = ((c >> 16) & 0xff) | (c & 0xff00) | ((c & 0xff) << 16) | 0xff000000;
+			}
+		}
+
+		///Draw debug vertices straight from the PhysX buffer (only the colours are converted)
+		void RenderDebugVertices(const DebugVertex* verts, PxU32 count, GLenum type)
+		{
+			if (!count)
+				return;
+
+			if (debug_colors.size() < count)
+				debug_colors.resize(count);
+			ConvertColors(verts, count, &debug_colors.front());
+
 			glEnableClientState(GL_VERTEX_ARRAY);
-			glVertexPointer(3,GL_FLOAT, 0, pVertList);
 			glEnableClientState(GL_COLOR_ARRAY);
-			glColorPointer(4, GL_FLOAT, 0, pColorList);
-			glDrawArrays(type, 0, num);
+			glVertexPointer(3, GL_FLOAT, sizeof(DebugVertex), &verts->pos);
+			glColorPointer(4, GL_UNSIGNED_BYTE, 0, &debug_colors.front());
+			glDrawArrays(type, 0, count);
 			glDisableClientState(GL_COLOR_ARRAY);
 			glDisableClientState(GL_VERTEX_ARRAY);
 		}
@@ -394,119 +1522,95 @@ namespace VisualDebugger
 		{
 			glLineWidth(line_width);
 
-			//render points
+			RenderDebugVertices((const DebugVertex*)data.getPoints(), data.getNbPoints(), GL_POINTS);
+			RenderDebugVertices((const DebugVertex*)data.getLines(), data.getNbLines()*2, GL_LINES);
+			RenderDebugVertices((const DebugVertex*)data.getTriangles(), data.getNbTriangles()*3, GL_TRIANGLES);
 
-			unsigned int NbPoints = data.getNbPoints();
-			if(NbPoints)
-			{
-				std::vector<float> pVertList(NbPoints*3);
-				std::vector<float> pColorList(NbPoints*4);
-				int vertIndex = 0;
-				int colorIndex = 0;
-				const physx::PxDebugPoint* Points = data.getPoints();
-				while(NbPoints--)
-				{
-					pVertList[vertIndex++] = Points->pos.x;
-					pVertList[vertIndex++] = Points->pos.y;
-					pVertList[vertIndex++] = Points->pos.z;
-					pColorList[colorIndex++] = (float)((Points->color>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Points->color>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Points->color&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-					Points++;
-				}
+			//TODO: render texts ?
+		}
 
-				RenderBuffer(&pVertList.front(), &pColorList.front(), GL_POINTS, data.getNbPoints());
-			}
+		void RenderDebug(const SceneSnapshot& snapshot, PxReal line_width)
+		{
+			glLineWidth(line_width);
 
-			//render lines
+			if (snapshot.points.size())
+				RenderDebugVertices((const DebugVertex*)&snapshot.points.front(), (PxU32)snapshot.points.size(), GL_POINTS);
+			if (snapshot.lines.size())
+				RenderDebugVertices((const DebugVertex*)&snapshot.lines.front(), (PxU32)snapshot.lines.size()*2, GL_LINES);
+			if (snapshot.triangles.size())
+				RenderDebugVertices((const DebugVertex*)&snapshot.triangles.front(), (PxU32)snapshot.triangles.size()*3, GL_TRIANGLES);
+		}
 
-			unsigned int NbLines = data.getNbLines();
-			if(NbLines)
-			{
-				std::vector<float> pVertList(NbLines*3*2);
-				std::vector<float> pColorList(NbLines*4*2);
-				int vertIndex = 0;
-				int colorIndex = 0;
-				const PxDebugLine* Lines = data.getLines();
-				while(NbLines--)
-				{
-					pVertList[vertIndex++] = Lines->pos0.x;
-					pVertList[vertIndex++] = Lines->pos0.y;
-					pVertList[vertIndex++] = Lines->pos0.z;
-					pColorList[colorIndex++] = (float)((Lines->color0>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Lines->color0>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Lines->color0&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					pVertList[vertIndex++] = Lines->pos1.x;
-					pVertList[vertIndex++] = Lines->pos1.y;
-					pVertList[vertIndex++] = Lines->pos1.z;
-					pColorList[colorIndex++] = (float)((Lines->color1>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Lines->color1>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Lines->color1&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					Lines++;
-				}
+		void RenderText(const std::string& text, const physx::PxVec2& location, 
+			const PxVec3& color, PxReal size)
+		{
+			GLFontRenderer::setColor(color.x, color.y, color.z, 1.f);
+			GLFontRenderer::setScreenResolution(target_width, target_height);
+			GLFontRenderer::print(location.x, location.y, size, text.c_str());
+		}
 
-				RenderBuffer(&pVertList.front(), &pColorList.front(), GL_LINES, data.getNbLines()*2);
-			}
+		///graph vertices (grows to the largest graph, then reused)
+		std::vector<PxVec2> graph_vertices;
+
+		void RenderGraph(const PxReal* values, PxU32 count, PxU32 first, PxReal max_value, PxReal reference,
+			const PxVec2& location, const PxVec2& size, const PxVec3& color)
+		{
+			if ((count < 2) || (max_value <= 0.f))
+				return;
 
-			//render triangles
+			if (graph_vertices.size() < count + 2)
+				graph_vertices.resize(count + 2);
 
-			unsigned int NbTris = data.getNbTriangles();
-			if(NbTris)
+			PxReal step = size.x / (count - 1);
+			for (PxU32 i = 0; i < count; i++)
 			{
-				std::vector<float> pVertList(NbTris*3*3);
-				std::vector<float> pColorList(NbTris*4*3);
-				int vertIndex = 0;
-				int colorIndex = 0;
-				const PxDebugTriangle* Triangles = data.getTriangles();
-				while(NbTris--)
-				{
-					pVertList[vertIndex++] = Triangles->pos0.x;
-					pVertList[vertIndex++] = Triangles->pos0.y;
-					pVertList[vertIndex++] = Triangles->pos0.z;
-
-					pVertList[vertIndex++] = Triangles->pos1.x;
-					pVertList[vertIndex++] = Triangles->pos1.y;
-					pVertList[vertIndex++] = Triangles->pos1.z;
-
-					pVertList[vertIndex++] = Triangles->pos2.x;
-					pVertList[vertIndex++] = Triangles->pos2.y;
-					pVertList[vertIndex++] = Triangles->pos2.z;
-
-					pColorList[colorIndex++] = (float)((Triangles->color0>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Triangles->color0>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Triangles->color0&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					pColorList[colorIndex++] = (float)((Triangles->color1>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Triangles->color1>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Triangles->color1&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					pColorList[colorIndex++] = (float)((Triangles->color2>>16)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)((Triangles->color2>>8)&0xff)/255.f;
-					pColorList[colorIndex++] = (float)(Triangles->color2&0xff)/255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					Triangles++;
-				}
-
-				RenderBuffer(&pVertList.front(), &pColorList.front(), GL_TRIANGLES, data.getNbTriangles()*3);
+				PxReal value = PxMin(values[(first + i) % count], max_value);
+				graph_vertices[i] = PxVec2(location.x + i*step, location.y + value / max_value * size.y);
 			}
 
-			//TODO: render texts ?
+			PxReal reference_y = location.y + PxMin(reference, max_value) / max_value * size.y;
+			graph_vertices[count] = PxVec2(location.x, reference_y);
+			graph_vertices[count+1] = PxVec2(location.x + size.x, reference_y);
+
+			glDisable(GL_LIGHTING);
+			glDisable(GL_DEPTH_TEST);
+
+			glMatrixMode(GL_PROJECTION);
+			glPushMatrix();
+			glLoadIdentity();
+			glOrtho(0, 1, 0, 1, -1, 1);
+			glMatrixMode(GL_MODELVIEW);
+			glPushMatrix();
+			glLoadIdentity();
+
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glVertexPointer(2, GL_FLOAT, sizeof(PxVec2), &graph_vertices.front());
+			glColor3f(color.x, color.y, color.z);
+			glDrawArrays(GL_LINE_STRIP, 0, count);
+			glColor3f(color.x*.5f, color.y*.5f, color.z*.5f);
+			glDrawArrays(GL_LINES, count, 2);
+			glDisableClientState(GL_VERTEX_ARRAY);
+
+			glMatrixMode(GL_PROJECTION);
+			glPopMatrix();
+			glMatrixMode(GL_MODELVIEW);
+			glPopMatrix();
+
+			glEnable(GL_DEPTH_TEST);
+			glEnable(GL_LIGHTING);
 		}
 
-		void RenderText(const std::string& text, const physx::PxVec2& location, 
+		void BuildText(GLFontText& block, const std::string& text, const physx::PxVec2& location,
 			const PxVec3& color, PxReal size)
 		{
 			GLFontRenderer::setColor(color.x, color.y, color.z, 1.f);
-			GLFontRenderer::setScreenResolution(glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT));
-			GLFontRenderer::print(location.x, location.y, size, text.c_str());
+			GLFontRenderer::setScreenResolution(target_width, target_height);
+			GLFontRenderer::build(block, location.x, location.y, size, text.c_str());
+		}
+
+		void RenderText(const GLFontText& block)
+		{
+			GLFontRenderer::draw(block);
 		}
 	}
 }
@@ -2,8 +2,10 @@
 
 #include "PxPhysicsAPI.h"
 #include "GLFontRenderer.h"
+#include "Snapshot.h"
 #include <GL/glut.h>
 #include <string>
+#include <vector>
 
 namespace VisualDebugger
 {
@@ -14,15 +16,60 @@ namespace VisualDebugger
 		///Init rendering window
 		void InitWindow(const char *name, int width, int height);
 
+		///Init an offscreen render target instead of a window (no display needed)
+		///Available in builds with RENDERER_OSMESA defined (links against OSMesa), returns false otherwise.
+		bool InitOffscreen(int width, int height);
+
 		///Init renderer
 		void Init();
 
+		///Release the offscreen render target
+		void Release();
+
+		///Capture every finished frame to <prefix>_00000.ppm images or a raw rgb24 video (<prefix>.rgb)
+		///Read back is asynchronous (pixel buffer objects) and files are written on a background thread.
+		void StartCapture(const char* prefix, bool raw=false);
+
+		///Stop capturing, wait for the remaining frames to be written and return the number of frames
+		PxU32 StopCapture();
+
+		///Set the target frame rate of the window (0 = unlimited), the idle loop sleeps until the next frame is due
+		void FrameRate(PxReal value);
+
+		///Get the target frame rate
+		PxReal FrameRate();
+
+		///Switch to a low redraw rate (e.g. while paused and nothing moves)
+		void LowPower(bool value);
+
+		///Get the low redraw rate state
+		bool LowPower();
+
+		///Enable or disable vertical sync of the window (returns false if not supported)
+		bool VSync(bool value);
+
+		///Width of the render target in pixels
+		int Width();
+
+		///Height of the render target in pixels
+		int Height();
+
+		///Read the current frame (RGB, rows bottom to top)
+		void ReadPixels(std::vector<unsigned char>& pixels);
+
 		///Start rendering a single frame
 		void Start(const PxVec3& cameraEye, const PxVec3& cameraDir);
 
-		///Render actors
+		///Render actors (reads the live PhysX objects, do not call while the scene is simulating)
 		void Render(PxActor** actors, const PxU32 numActors);
 
+		///Render a scene snapshot (does not touch any PhysX objects)
+		///Alpha blends the poses between the previous step (0) and the step of the snapshot (1).
+		void Render(const SceneSnapshot& snapshot, PxReal alpha=1.f);
+
+		///Render the debug visualisation of a scene snapshot
+		void RenderDebug(const SceneSnapshot& snapshot, PxReal line_width=1.f);
+
 		///Render debug information
 		void Render(const PxRenderBuffer& data, PxReal line_width=1.f);
 
@@ -30,6 +77,19 @@ namespace VisualDebugger
 		void RenderText(const std::string& text, const physx::PxVec2& location, 
 			const PxVec3& color, PxReal size);
 
+		///Build text into a retained text block (appends to the existing content)
+		void BuildText(GLFontText& block, const std::string& text, const physx::PxVec2& location,
+			const PxVec3& color, PxReal size);
+
+		///Render a retained text block built with BuildText
+		void RenderText(const GLFontText& block);
+
+		///Render a line graph of a ring buffer of values in screen space
+		///location and size are in window units (0-1), first is the oldest sample,
+		///reference draws a horizontal line at the given value (e.g. a frame budget).
+		void RenderGraph(const PxReal* values, PxU32 count, PxU32 first, PxReal max_value, PxReal reference,
+			const PxVec2& location, const PxVec2& size, const PxVec3& color);
+
 		///Set background color
 		void BackgroundColor(const PxVec3& background_color);
 
@@ -37,6 +97,7 @@ namespace VisualDebugger
 		void Finish();
 
 		///Set rendering detail for spheres and capsules.
+		///This is the detail of the closest ones, distant ones use coarser levels.
 		void SetRenderDetail(int value);
 
 		///Set show shadows
@@ -44,5 +105,8 @@ namespace VisualDebugger
 
 		///Get show shadows
 		bool ShowShadows();
+
+		///Number of shapes culled by the view frustum in the current frame
+		PxU32 CulledShapes();
 	}
 }
\ No newline at end of file
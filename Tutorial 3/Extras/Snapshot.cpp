@@ -0,0 +1,257 @@
+#include "Snapshot.h"
+#include "UserData.h"
+#include <algorithm>
+
+namespace VisualDebugger
+{
+	//pose, bounds and colour of a cloth, its particles are appended to the snapshot
+	static void SnapshotCloth(const PxCloth* cloth, const RenderComponents::Reader& components, ClothSnapshot& cloth_snapshot, SceneSnapshot& snapshot)
+	{
+		RenderHandle handle = GetRenderHandle(cloth->userData);
+		cloth_snapshot.pose = cloth->getGlobalPose();
+		cloth_snapshot.previous_pose = cloth_snapshot.pose;
+		cloth_snapshot.bounds = cloth->getWorldBounds();
+		cloth_snapshot.color = components.Valid(handle) ? components.Color(handle) : PxVec3(0.f);
+		cloth_snapshot.first_particle = (PxU32)snapshot.particles.size();
+		cloth_snapshot.nb_particles = 0;
+
+		PxClothParticleData* particle_data = cloth->lockParticleData(PxDataAccessFlag::eREADABLE);
+		if (particle_data)
+		{
+			cloth_snapshot.nb_particles = cloth->getNbParticles();
+			snapshot.particles.insert(snapshot.particles.end(), particle_data->particles, particle_data->particles + cloth_snapshot.nb_particles);
+			particle_data->unlock();
+		}
+	}
+
+	//colour of a shape
+	static void SnapshotColor(const RenderComponents::Reader& components, ShapeSnapshot& shape_snapshot)
+	{
+		RenderHandle handle = GetRenderHandle(shape_snapshot.shape->userData);
+		shape_snapshot.colored = components.Valid(handle);
+		shape_snapshot.color = shape_snapshot.colored ? components.Color(handle) : PxVec3(0.f);
+		shape_snapshot.palette = shape_snapshot.colored ? components.Palette(handle) : 0;
+	}
+
+	//pose and bounds of an actor and its shapes
+	static void SnapshotPose(ActorSnapshot& actor_snapshot, SceneSnapshot& snapshot)
+	{
+		const PxRigidActor* rigid_actor = actor_snapshot.actor;
+		actor_snapshot.pose = rigid_actor->getGlobalPose();
+		actor_snapshot.bounds = rigid_actor->getWorldBounds();
+
+		for (PxU32 j = actor_snapshot.first_shape; j < actor_snapshot.first_shape + actor_snapshot.nb_shapes; j++)
+		{
+			ShapeSnapshot& shape_snapshot = snapshot.shapes[j];
+			shape_snapshot.pose = actor_snapshot.pose * shape_snapshot.local_pose;
+			shape_snapshot.previous_pose = shape_snapshot.pose;
+			shape_snapshot.world = PxMat44(shape_snapshot.pose);
+			shape_snapshot.moved = false;
+			shape_snapshot.bounds = PxShapeExt::getWorldBounds(*shape_snapshot.shape, *rigid_actor);
+		}
+	}
+
+	void TakeSnapshot(PxActor** actors, PxU32 nb_actors, SceneSnapshot& snapshot)
+	{
+		snapshot.statics = 0;
+		snapshot.actors.clear();
+		snapshot.shapes.clear();
+		snapshot.cloths.clear();
+		snapshot.particles.clear();
+
+		//one lock for all render components
+		RenderComponents::Reader components(GetRenderComponents());
+
+		for (PxU32 i = 0; i < nb_actors; i++)
+		{
+			if (actors[i]->isCloth())
+			{
+				const PxCloth* cloth = (const PxCloth*)actors[i];
+				const PxClothMeshDesc* mesh_desc = components.Valid(GetRenderHandle(cloth->userData)) ?
+					components.ClothMeshDesc(GetRenderHandle(cloth->userData)) : 0;
+
+				ClothSnapshot cloth_snapshot;
+				cloth_snapshot.cloth = cloth;
+				cloth_snapshot.quads = mesh_desc ? (const PxU32*)mesh_desc->quads.data : 0;
+				cloth_snapshot.nb_quads = mesh_desc ? mesh_desc->quads.count : 0;
+				SnapshotCloth(cloth, components, cloth_snapshot, snapshot);
+
+				snapshot.cloths.push_back(cloth_snapshot);
+			}
+			else if (actors[i]->isRigidActor())
+			{
+				const PxRigidActor* rigid_actor = (const PxRigidActor*)actors[i];
+
+				ActorSnapshot actor_snapshot;
+				actor_snapshot.actor = rigid_actor;
+				actor_snapshot.dynamic = rigid_actor->getType() == PxActorType::eRIGID_DYNAMIC;
+				actor_snapshot.first_shape = (PxU32)snapshot.shapes.size();
+				actor_snapshot.nb_shapes = rigid_actor->getNbShapes();
+
+				for (PxU32 j = 0; j < actor_snapshot.nb_shapes; j++)
+				{
+					PxShape* shape;
+					rigid_actor->getShapes(&shape, 1, j);
+
+					ShapeSnapshot shape_snapshot;
+					shape_snapshot.shape = shape;
+					shape_snapshot.geometry = shape->getGeometry();
+					shape_snapshot.local_pose = shape->getLocalPose();
+					SnapshotColor(components, shape_snapshot);
+
+					snapshot.shapes.push_back(shape_snapshot);
+				}
+
+				SnapshotPose(actor_snapshot, snapshot);
+				snapshot.actors.push_back(actor_snapshot);
+			}
+		}
+	}
+
+	void UpdateSnapshot(PxActor** actors, PxU32 nb_actors, PxActor*const* moved, PxU32 nb_moved, PxU32 revision,
+		SnapshotCache& cache, SceneSnapshot& snapshot)
+	{
+		SceneSnapshot& cached = cache.snapshot;
+
+		//different actors or poses changed outside of a step: start over
+		if (!cache.valid || (revision != cache.revision) || (nb_actors != cache.actors.size()) ||
+			(nb_actors && !std::equal(actors, actors + nb_actors, cache.actors.begin())))
+		{
+			//colours changed while taking the snapshot are read again by the next update
+			cache.colors = GetRenderComponents().Version();
+			TakeSnapshot(actors, nb_actors, cached);
+
+			cache.actors.assign(actors, actors + nb_actors);
+			cache.actor_index.clear();
+			cache.kinematic.clear();
+			cache.dynamic.clear();
+			for (PxU32 i = 0; i < cached.actors.size(); i++)
+			{
+				const PxRigidActor* actor = cached.actors[i].actor;
+				cache.actor_index[actor] = i;
+				if (!cached.actors[i].dynamic)
+					continue;
+				cache.dynamic.push_back(i);
+				if (((const PxRigidDynamic*)actor)->getRigidDynamicFlags() & PxRigidDynamicFlag::eKINEMATIC)
+					cache.kinematic.push_back(i);
+			}
+			cache.revision = revision;
+			cache.statics++;
+			cache.valid = true;
+		}
+		else
+		{
+			for (PxU32 i = 0; i < nb_moved; i++)
+			{
+				std::unordered_map<const PxActor*, PxU32>::const_iterator found = cache.actor_index.find(moved[i]);
+				if (found != cache.actor_index.end())
+					SnapshotPose(cached.actors[found->second], cached);
+			}
+			for (PxU32 i = 0; i < cache.kinematic.size(); i++)
+				SnapshotPose(cached.actors[cache.kinematic[i]], cached);
+
+			//colours change without a move (highlighting), cloths move all the time
+			RenderComponents::Reader components(GetRenderComponents());
+			if (components.Version() != cache.colors)
+			{
+				for (PxU32 i = 0; i < cached.shapes.size(); i++)
+					SnapshotColor(components, cached.shapes[i]);
+				cache.colors = components.Version();
+				cache.statics++;
+			}
+
+			cached.particles.clear();
+			for (PxU32 i = 0; i < cached.cloths.size(); i++)
+				SnapshotCloth(cached.cloths[i].cloth, components, cached.cloths[i], cached);
+		}
+
+		cached.statics = cache.statics;
+		CopyRigidState(cached, cache, snapshot);
+		snapshot.cloths = cached.cloths;
+		snapshot.particles = cached.particles;
+	}
+
+	void CopyRigidState(const SceneSnapshot& source, const SnapshotCache& cache, SceneSnapshot& snapshot)
+	{
+		if (!source.statics || (snapshot.statics != source.statics) ||
+			(snapshot.actors.size() != source.actors.size()) || (snapshot.shapes.size() != source.shapes.size()))
+		{
+			snapshot.actors = source.actors;
+			snapshot.shapes = source.shapes;
+			snapshot.statics = source.statics;
+			return;
+		}
+
+		//the static actors and shapes are already in place
+		for (PxU32 i = 0; i < cache.dynamic.size(); i++)
+		{
+			const ActorSnapshot& actor = source.actors[cache.dynamic[i]];
+			snapshot.actors[cache.dynamic[i]] = actor;
+			std::copy(source.shapes.begin() + actor.first_shape, source.shapes.begin() + actor.first_shape + actor.nb_shapes,
+				snapshot.shapes.begin() + actor.first_shape);
+		}
+	}
+
+	void CopyPreviousPoses(const SceneSnapshot& previous, SceneSnapshot& snapshot)
+	{
+		//actors are kept in the same order between steps, so a match by index is almost always a hit
+		PxU32 nb_shapes = (PxU32)PxMin(previous.shapes.size(), snapshot.shapes.size());
+		for (PxU32 i = 0; i < nb_shapes; i++)
+		{
+			ShapeSnapshot& shape = snapshot.shapes[i];
+			if (shape.shape == previous.shapes[i].shape)
+			{
+				shape.previous_pose = previous.shapes[i].pose;
+				shape.moved = !(shape.pose.p == shape.previous_pose.p) || (shape.pose.q.x != shape.previous_pose.q.x) ||
+					(shape.pose.q.y != shape.previous_pose.q.y) || (shape.pose.q.z != shape.previous_pose.q.z) || (shape.pose.q.w != shape.previous_pose.q.w);
+			}
+		}
+
+		PxU32 nb_cloths = (PxU32)PxMin(previous.cloths.size(), snapshot.cloths.size());
+		for (PxU32 i = 0; i < nb_cloths; i++)
+		{
+			if (snapshot.cloths[i].cloth == previous.cloths[i].cloth)
+				snapshot.cloths[i].previous_pose = previous.cloths[i].pose;
+		}
+	}
+
+	PxQuat Slerp(const PxQuat& from, const PxQuat& to, PxReal t)
+	{
+		PxQuat target = to;
+		PxReal cosine = from.dot(to);
+		//q and -q are the same rotation, take the shorter way
+		if (cosine < 0.f)
+		{
+			cosine = -cosine;
+			target = -to;
+		}
+
+		//nearly identical rotations: fall back to a normalised linear interpolation
+		if (cosine > 0.9995f)
+			return (from*(1.f - t) + target*t).getNormalized();
+
+		PxReal angle = PxAcos(cosine);
+		PxReal sine = PxSin(angle);
+		return from*(PxSin((1.f - t)*angle)/sine) + target*(PxSin(t*angle)/sine);
+	}
+
+	PxTransform Interpolate(const PxTransform& from, const PxTransform& to, PxReal t)
+	{
+		return PxTransform(from.p + (to.p - from.p)*t, Slerp(from.q, to.q, t));
+	}
+
+	void TakeDebugSnapshot(const PxRenderBuffer* data, SceneSnapshot& snapshot)
+	{
+		if (!data)
+		{
+			snapshot.points.clear();
+			snapshot.lines.clear();
+			snapshot.triangles.clear();
+			return;
+		}
+
+		snapshot.points.assign(data->getPoints(), data->getPoints() + data->getNbPoints());
+		snapshot.lines.assign(data->getLines(), data->getLines() + data->getNbLines());
+		snapshot.triangles.assign(data->getTriangles(), data->getTriangles() + data->getNbTriangles());
+	}
+}
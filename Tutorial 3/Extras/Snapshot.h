@@ -0,0 +1,134 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include <vector>
+#include <chrono>
+#include <unordered_map>
+
+namespace VisualDebugger
+{
+	using namespace physx;
+
+	///Render state of a single shape
+	struct ShapeSnapshot
+	{
+		//identity of the shape (render cache key), never accessed by the renderer
+		const PxShape* shape;
+		PxGeometryHolder geometry;
+		//pose after this step and after the step before (for interpolation)
+		PxTransform pose, previous_pose;
+		//pose relative to the actor
+		PxTransform local_pose;
+		//world matrix of the pose, only recomputed when the pose changes
+		PxMat44 world;
+		//the pose differs from the previous pose (otherwise the world matrix is used as is)
+		bool moved;
+		PxBounds3 bounds;
+		PxVec3 color;
+		bool colored;
+		const PxVec3* palette;
+	};
+
+	///Render state of a rigid actor (a range of shapes)
+	struct ActorSnapshot
+	{
+		//identity of the actor (snapshot cache key), never accessed by the renderer
+		const PxRigidActor* actor;
+		PxTransform pose;
+		PxBounds3 bounds;
+		//dynamic (or kinematic) actors are the only ones that move
+		bool dynamic;
+		PxU32 first_shape;
+		PxU32 nb_shapes;
+	};
+
+	///Render state of a cloth (a range of particles)
+	struct ClothSnapshot
+	{
+		//identity of the cloth (render cache key), never accessed by the renderer
+		const PxCloth* cloth;
+		//the pose is interpolated, the particles are always drawn at their latest positions
+		PxTransform pose, previous_pose;
+		PxBounds3 bounds;
+		PxVec3 color;
+		//the quads belong to the cloth mesh description, which does not change
+		const PxU32* quads;
+		PxU32 nb_quads;
+		PxU32 first_particle;
+		PxU32 nb_particles;
+	};
+
+	///Immutable copy of everything the renderer needs from a simulation step
+	///The vectors keep their capacity when a snapshot is refilled, so taking snapshots does not allocate in steady state.
+	struct SceneSnapshot
+	{
+		std::vector<ActorSnapshot> actors;
+		std::vector<ShapeSnapshot> shapes;
+		std::vector<ClothSnapshot> cloths;
+		std::vector<PxClothParticle> particles;
+
+		//debug visualisation (only taken on request)
+		std::vector<PxDebugPoint> points;
+		std::vector<PxDebugLine> lines;
+		std::vector<PxDebugTriangle> triangles;
+
+		PxSimulationStatistics statistics;
+		PxReal simulate_time, fetch_time;
+		bool pause;
+		PxU32 step;
+		//length of the step that produced the snapshot and when it was published
+		PxReal step_time;
+		std::chrono::high_resolution_clock::time_point published;
+		//version of the static actors and shapes copied from a snapshot cache (0 when they were not, see CopyRigidState)
+		PxU32 statics;
+
+		SceneSnapshot() : simulate_time(0.f), fetch_time(0.f), pause(false), step(0), step_time(0.f), statics(0) {}
+	};
+
+	///Render state of a scene kept between steps (see UpdateSnapshot)
+	struct SnapshotCache
+	{
+		SceneSnapshot snapshot;
+		//the actors of the cached snapshot, the rigid ones by snapshot actor index
+		std::vector<PxActor*> actors;
+		std::unordered_map<const PxActor*, PxU32> actor_index;
+		//kinematic actors can be moved without being reported as moved
+		std::vector<PxU32> kinematic;
+		//dynamic actors (including the kinematic ones), the others only change when the cache is rebuilt or the colours change
+		std::vector<PxU32> dynamic;
+		PxU32 revision;
+		//render component version of the cached colours and version of the static actors and shapes
+		PxU32 colors, statics;
+		bool valid;
+
+		SnapshotCache() : revision(0), colors(0), statics(0), valid(false) {}
+	};
+
+	///Copy the render state of the actors into a snapshot (replaces the shapes, actors and cloths)
+	void TakeSnapshot(PxActor** actors, PxU32 nb_actors, SceneSnapshot& snapshot);
+
+	///Refresh a cached snapshot and copy it into a snapshot (replaces the shapes, actors and cloths)
+	///Only the moved actors (PhysX active transforms), kinematic actors, changed colours and cloths are read again, the poses and
+	///world matrices of static and sleeping actors are kept. The cache is rebuilt when the actors or the revision change
+	///(the scene changes its revision when actors are moved outside of a simulation step).
+	void UpdateSnapshot(PxActor** actors, PxU32 nb_actors, PxActor*const* moved, PxU32 nb_moved, PxU32 revision,
+		SnapshotCache& cache, SceneSnapshot& snapshot);
+
+	///Copy the actors and shapes of a snapshot refreshed from a cache into another snapshot
+	///When the static actors and shapes of the destination are already those of the cache, only the dynamic ones are copied.
+	void CopyRigidState(const SceneSnapshot& source, const SnapshotCache& cache, SceneSnapshot& snapshot);
+
+	///Fill in the previous poses of a snapshot from the snapshot of the step before
+	///Shapes and cloths are matched by position in the snapshot; anything that was added or reordered
+	///since the previous step keeps its current pose. Shapes are marked as moved when their poses differ.
+	void CopyPreviousPoses(const SceneSnapshot& previous, SceneSnapshot& snapshot);
+
+	///Spherical linear interpolation between two unit quaternions (along the shorter arc)
+	PxQuat Slerp(const PxQuat& from, const PxQuat& to, PxReal t);
+
+	///Interpolate between two poses: linear for the position, spherical for the rotation
+	PxTransform Interpolate(const PxTransform& from, const PxTransform& to, PxReal t);
+
+	///Copy the debug visualisation into a snapshot (clears it when data is 0)
+	void TakeDebugSnapshot(const PxRenderBuffer* data, SceneSnapshot& snapshot);
+}
@@ -0,0 +1,496 @@
+#include "SnapshotCodec.h"
+#include <cstring>
+
+namespace VisualDebugger
+{
+	using namespace SnapshotCodec;
+
+	///Bit packing
+
+	struct BitWriter
+	{
+		unsigned char* data;
+		PxU32 capacity, position;
+		bool overflow;
+
+		BitWriter(unsigned char* _data, PxU32 bytes) : data(_data), capacity(bytes*8), position(0), overflow(false) {}
+
+		void Write(PxU32 value, PxU32 bits)
+		{
+			if (position + bits > capacity)
+			{
+				overflow = true;
+				return;
+			}
+			for (PxU32 i = 0; i < bits; i++, position++)
+			{
+				unsigned char& byte = data[position >> 3];
+				if (!(position & 7))
+					byte = 0;
+				if ((value >> i) & 1)
+					byte |= (unsigned char)(1 << (position & 7));
+			}
+		}
+
+		PxU32 Bytes() { return (position + 7) >> 3; }
+	};
+
+	struct BitReader
+	{
+		const unsigned char* data;
+		PxU32 size, position;
+		bool overflow;
+
+		BitReader(const unsigned char* _data, PxU32 bytes) : data(_data), size(bytes*8), position(0), overflow(false) {}
+
+		PxU32 Read(PxU32 bits)
+		{
+			if (position + bits > size)
+			{
+				overflow = true;
+				return 0;
+			}
+			PxU32 value = 0;
+			for (PxU32 i = 0; i < bits; i++, position++)
+				if ((data[position >> 3] >> (position & 7)) & 1)
+					value |= 1u << i;
+			return value;
+		}
+	};
+
+	///Delta coding
+	///A zero delta is a single 0 bit, other deltas are a prefix of 1 bits selecting the width of the zigzag value.
+
+	static const PxU32 DELTA_CLASSES = 4;
+	static const PxU32 DELTA_WIDTHS[DELTA_CLASSES] = { 4, 8, 12, 32 };
+
+	static PxU32 ZigZag(PxI32 value)
+	{
+		return ((PxU32)value << 1) ^ (PxU32)(value >> 31);
+	}
+
+	static PxI32 UnZigZag(PxU32 value)
+	{
+		return (PxI32)(value >> 1) ^ -(PxI32)(value & 1);
+	}
+
+	static PxU32 DeltaClass(PxU32 value)
+	{
+		PxU32 c = 0;
+		while ((c < DELTA_CLASSES - 1) && (value >= (1u << DELTA_WIDTHS[c])))
+			c++;
+		return c;
+	}
+
+	static PxU32 DeltaBits(PxI32 delta)
+	{
+		PxU32 value = ZigZag(delta);
+		if (!value)
+			return 1;
+		PxU32 c = DeltaClass(value);
+		return 1 + c + ((c < DELTA_CLASSES - 1) ? 1 : 0) + DELTA_WIDTHS[c];
+	}
+
+	static void WriteDelta(BitWriter& writer, PxI32 delta)
+	{
+		PxU32 value = ZigZag(delta);
+		writer.Write(value ? 1 : 0, 1);
+		if (!value)
+			return;
+		PxU32 c = DeltaClass(value);
+		for (PxU32 i = 0; i < c; i++)
+			writer.Write(1, 1);
+		if (c < DELTA_CLASSES - 1)
+			writer.Write(0, 1);
+		writer.Write(value, DELTA_WIDTHS[c]);
+	}
+
+	static PxI32 ReadDelta(BitReader& reader)
+	{
+		if (!reader.Read(1))
+			return 0;
+		PxU32 c = 0;
+		while ((c < DELTA_CLASSES - 1) && reader.Read(1))
+			c++;
+		return UnZigZag(reader.Read(DELTA_WIDTHS[c]));
+	}
+
+	///Quantisation
+
+	static PxI32 Round(PxReal value)
+	{
+		return (PxI32)PxFloor(value + .5f);
+	}
+
+	static void QuantizePose(const PxTransform& pose, QuantizedPose& quantized)
+	{
+		for (PxU32 i = 0; i < 3; i++)
+			quantized.position[i] = Round(pose.p[i] * POSITION_SCALE);
+
+		//smallest three: drop the largest component and make it positive, the others are within +-1/sqrt(2)
+		PxQuat q = pose.q.getNormalized();
+		PxReal components[4] = { q.x, q.y, q.z, q.w };
+		quantized.largest = 0;
+		for (PxU32 i = 1; i < 4; i++)
+			if (PxAbs(components[i]) > PxAbs(components[quantized.largest]))
+				quantized.largest = i;
+		PxReal sign = (components[quantized.largest] < 0.f) ? -1.f : 1.f;
+		for (PxU32 i = 0, j = 0; i < 4; i++)
+			if (i != quantized.largest)
+				quantized.rotation[j++] = Round(components[i] * sign * ROTATION_SCALE);
+	}
+
+	static PxTransform DequantizePose(const QuantizedPose& quantized)
+	{
+		PxVec3 position(quantized.position[0] / POSITION_SCALE, quantized.position[1] / POSITION_SCALE, quantized.position[2] / POSITION_SCALE);
+
+		PxReal components[4];
+		PxReal sum = 0.f;
+		for (PxU32 i = 0, j = 0; i < 4; i++)
+			if (i != quantized.largest)
+			{
+				components[i] = quantized.rotation[j++] / ROTATION_SCALE;
+				sum += components[i]*components[i];
+			}
+		components[quantized.largest] = PxSqrt(PxMax(1.f - sum, 0.f));
+
+		return PxTransform(position, PxQuat(components[0], components[1], components[2], components[3]).getNormalized());
+	}
+
+	static bool SamePose(const QuantizedPose& a, const QuantizedPose& b)
+	{
+		return !memcmp(&a, &b, sizeof(QuantizedPose));
+	}
+
+	//number of moving poses (dynamic actors and cloths) and cloth particles of a snapshot
+	static void CountLayout(const SceneSnapshot& snapshot, PxU32& nb_poses, PxU32& nb_particles)
+	{
+		nb_poses = (PxU32)snapshot.cloths.size();
+		for (PxU32 i = 0; i < snapshot.actors.size(); i++)
+			if (snapshot.actors[i].dynamic)
+				nb_poses++;
+		nb_particles = (PxU32)snapshot.particles.size();
+	}
+
+	static void Quantize(const SceneSnapshot& snapshot, QuantizedPose* poses, PxI32* particles)
+	{
+		PxU32 p = 0;
+		for (PxU32 i = 0; i < snapshot.actors.size(); i++)
+			if (snapshot.actors[i].dynamic)
+				QuantizePose(snapshot.actors[i].pose, poses[p++]);
+		for (PxU32 i = 0; i < snapshot.cloths.size(); i++)
+			QuantizePose(snapshot.cloths[i].pose, poses[p++]);
+
+		//cloth particles are in the cloth frame
+		for (PxU32 i = 0; i < snapshot.particles.size(); i++)
+			for (PxU32 j = 0; j < 3; j++)
+				particles[i*3 + j] = Round(snapshot.particles[i].pos[j] * PARTICLE_SCALE);
+	}
+
+	static void InitState(QuantizedState& state, PxU32 nb_poses, PxU32 nb_particles)
+	{
+		state.sequence = 0;
+		state.valid = false;
+		state.poses.resize(nb_poses);
+		state.particles.resize(nb_particles*3);
+	}
+
+	static void InitSeed(const SceneSnapshot& layout, QuantizedState& seed, PxU32 nb_poses, PxU32 nb_particles)
+	{
+		InitState(seed, nb_poses, nb_particles);
+		Quantize(layout, seed.poses.data(), seed.particles.data());
+		seed.valid = true;
+	}
+
+	static void WritePose(BitWriter& writer, const QuantizedPose& base, const QuantizedPose& pose)
+	{
+		bool changed = !SamePose(base, pose);
+		writer.Write(changed ? 1 : 0, 1);
+		if (!changed)
+			return;
+
+		for (PxU32 i = 0; i < 3; i++)
+			WriteDelta(writer, pose.position[i] - base.position[i]);
+
+		//the components are only comparable while the same component is dropped
+		bool same_largest = pose.largest == base.largest;
+		writer.Write(same_largest ? 0 : 1, 1);
+		if (!same_largest)
+			writer.Write(pose.largest, 2);
+		for (PxU32 i = 0; i < 3; i++)
+			WriteDelta(writer, pose.rotation[i] - (same_largest ? base.rotation[i] : 0));
+	}
+
+	static void ReadPose(BitReader& reader, const QuantizedPose& base, QuantizedPose& pose)
+	{
+		pose = base;
+		if (!reader.Read(1))
+			return;
+
+		for (PxU32 i = 0; i < 3; i++)
+			pose.position[i] = base.position[i] + ReadDelta(reader);
+
+		bool same_largest = !reader.Read(1);
+		if (!same_largest)
+			pose.largest = reader.Read(2);
+		for (PxU32 i = 0; i < 3; i++)
+			pose.rotation[i] = ReadDelta(reader) + (same_largest ? base.rotation[i] : 0);
+	}
+
+	//sequence numbers wrap around, a is newer than b when it is less than half the range ahead
+	static bool Newer(PxU16 a, PxU16 b)
+	{
+		return (PxI16)(a - b) > 0;
+	}
+
+	///SnapshotEncoder methods
+
+	SnapshotEncoder::SnapshotEncoder(const SceneSnapshot& layout, PxU32 _packet_budget)
+		: packet_budget(_packet_budget), sequence(0), baseline(0), acknowledged(false), particle_cursor(0)
+	{
+		CountLayout(layout, nb_poses, nb_particles);
+		InitSeed(layout, seed, nb_poses, nb_particles);
+
+		history.resize(HISTORY);
+		for (PxU32 i = 0; i < HISTORY; i++)
+			InitState(history[i], nb_poses, nb_particles);
+		particles.resize(nb_particles*3);
+	}
+
+	PxU32 SnapshotEncoder::Encode(const SceneSnapshot& snapshot, unsigned char* packet, PxU32 capacity)
+	{
+		PxU32 snapshot_poses, snapshot_particles;
+		CountLayout(snapshot, snapshot_poses, snapshot_particles);
+		if ((snapshot_poses != nb_poses) || (snapshot_particles != nb_particles))
+			return 0;
+
+		sequence++;
+
+		//the baseline has to survive the slot of the new state
+		const QuantizedState* base = &seed;
+		if (acknowledged && ((PxU16)(sequence - baseline) < HISTORY))
+		{
+			const QuantizedState& state = history[baseline % HISTORY];
+			if (state.valid && (state.sequence == baseline))
+				base = &state;
+		}
+
+		QuantizedState& state = history[sequence % HISTORY];
+		state.sequence = sequence;
+		state.valid = false;
+		Quantize(snapshot, state.poses.data(), particles.data());
+
+		BitWriter writer(packet, PxMin(capacity, MAX_PACKET));
+		writer.Write(sequence, 16);
+		writer.Write((base != &seed) ? 1 : 0, 1);
+		if (base != &seed)
+			writer.Write(baseline, 16);
+		writer.Write(nb_poses, 16);
+		writer.Write(nb_particles, 24);
+
+		for (PxU32 i = 0; i < nb_poses; i++)
+			WritePose(writer, base->poses[i], state.poses[i]);
+
+		//as many particles as fit the budget, continuing where the last packet stopped
+		PxU32 budget = PxMin(packet_budget, PxMin(capacity, MAX_PACKET))*8;
+		PxU32 bits = writer.position + 48;
+		PxU32 count = 0;
+		for (; count < nb_particles; count++)
+		{
+			PxU32 index = ((particle_cursor + count) % nb_particles)*3;
+			PxU32 particle_bits = 0;
+			for (PxU32 j = 0; j < 3; j++)
+				particle_bits += DeltaBits(particles[index + j] - base->particles[index + j]);
+			if (bits + particle_bits > budget)
+				break;
+			bits += particle_bits;
+		}
+
+		writer.Write(particle_cursor, 24);
+		writer.Write(count, 24);
+
+		//particles left out keep the state of the baseline
+		state.particles = base->particles;
+		for (PxU32 i = 0; i < count; i++)
+		{
+			PxU32 index = ((particle_cursor + i) % nb_particles)*3;
+			for (PxU32 j = 0; j < 3; j++)
+			{
+				WriteDelta(writer, particles[index + j] - base->particles[index + j]);
+				state.particles[index + j] = particles[index + j];
+			}
+		}
+
+		if (writer.overflow)
+			return 0;
+
+		if (nb_particles)
+			particle_cursor = (particle_cursor + count) % nb_particles;
+		state.valid = true;
+		return writer.Bytes();
+	}
+
+	void SnapshotEncoder::Acknowledge(PxU16 _sequence)
+	{
+		if (!acknowledged || Newer(_sequence, baseline))
+		{
+			baseline = _sequence;
+			acknowledged = true;
+		}
+	}
+
+	///SnapshotDecoder methods
+
+	SnapshotDecoder::SnapshotDecoder(const SceneSnapshot& layout)
+		: latest(0), received(false)
+	{
+		CountLayout(layout, nb_poses, nb_particles);
+		InitSeed(layout, seed, nb_poses, nb_particles);
+
+		history.resize(HISTORY);
+		for (PxU32 i = 0; i < HISTORY; i++)
+			InitState(history[i], nb_poses, nb_particles);
+	}
+
+	bool SnapshotDecoder::Decode(const unsigned char* packet, PxU32 size)
+	{
+		BitReader reader(packet, size);
+		PxU16 sequence = (PxU16)reader.Read(16);
+		bool has_baseline = reader.Read(1) != 0;
+		PxU16 baseline = has_baseline ? (PxU16)reader.Read(16) : 0;
+		PxU32 packet_poses = reader.Read(16);
+		PxU32 packet_particles = reader.Read(24);
+
+		if (reader.overflow || (packet_poses != nb_poses) || (packet_particles != nb_particles))
+			return false;
+
+		//late and duplicate packets are of no use
+		if (received && !Newer(sequence, latest))
+			return false;
+
+		const QuantizedState* base = &seed;
+		if (has_baseline)
+		{
+			if ((PxU16)(sequence - baseline) >= HISTORY)
+				return false;
+			const QuantizedState& state = history[baseline % HISTORY];
+			if (!state.valid || (state.sequence != baseline))
+				return false;
+			base = &state;
+		}
+
+		QuantizedState& state = history[sequence % HISTORY];
+		state.sequence = sequence;
+		state.valid = false;
+
+		for (PxU32 i = 0; i < nb_poses; i++)
+			ReadPose(reader, base->poses[i], state.poses[i]);
+
+		PxU32 first = reader.Read(24);
+		PxU32 count = reader.Read(24);
+		if (reader.overflow || (count > nb_particles) || (count && (first >= nb_particles)))
+			return false;
+
+		state.particles = base->particles;
+		for (PxU32 i = 0; i < count; i++)
+		{
+			PxU32 index = ((first + i) % nb_particles)*3;
+			for (PxU32 j = 0; j < 3; j++)
+				state.particles[index + j] = base->particles[index + j] + ReadDelta(reader);
+		}
+
+		if (reader.overflow)
+			return false;
+
+		state.valid = true;
+		latest = sequence;
+		received = true;
+		return true;
+	}
+
+	void SnapshotDecoder::Apply(SceneSnapshot& snapshot)
+	{
+		PxU32 snapshot_poses, snapshot_particles;
+		CountLayout(snapshot, snapshot_poses, snapshot_particles);
+		if (!received || (snapshot_poses != nb_poses) || (snapshot_particles != nb_particles))
+			return;
+
+		const QuantizedState& state = history[latest % HISTORY];
+
+		PxU32 p = 0;
+		for (PxU32 i = 0; i < snapshot.actors.size(); i++)
+		{
+			ActorSnapshot& actor = snapshot.actors[i];
+			if (!actor.dynamic)
+				continue;
+
+			//the bounds follow the actor (conservatively)
+			PxTransform pose = DequantizePose(state.poses[p++]);
+			PxTransform motion = pose * actor.pose.getInverse();
+			actor.pose = pose;
+			actor.bounds = PxBounds3::transformFast(motion, actor.bounds);
+
+			for (PxU32 j = actor.first_shape; j < actor.first_shape + actor.nb_shapes; j++)
+			{
+				ShapeSnapshot& shape = snapshot.shapes[j];
+				shape.pose = pose * shape.local_pose;
+				shape.world = PxMat44(shape.pose);
+				shape.bounds = PxBounds3::transformFast(motion, shape.bounds);
+			}
+		}
+
+		for (PxU32 i = 0; i < snapshot.cloths.size(); i++)
+		{
+			ClothSnapshot& cloth = snapshot.cloths[i];
+			PxTransform pose = DequantizePose(state.poses[p++]);
+			cloth.bounds = PxBounds3::transformFast(pose * cloth.pose.getInverse(), cloth.bounds);
+			cloth.pose = pose;
+		}
+
+		for (PxU32 i = 0; i < snapshot.particles.size(); i++)
+			snapshot.particles[i].pos = PxVec3((PxReal)state.particles[i*3], (PxReal)state.particles[i*3 + 1], (PxReal)state.particles[i*3 + 2]) / PARTICLE_SCALE;
+	}
+
+	///LoopbackChannel methods
+
+	LoopbackChannel::LoopbackChannel(PxU32 nb_slots)
+		: slots(nb_slots*MAX_PACKET), sizes(nb_slots), first(0), count(0), bytes_sent(0)
+	{
+	}
+
+	void LoopbackChannel::Send(const unsigned char* packet, PxU32 size)
+	{
+		PxU32 nb_slots = (PxU32)sizes.size();
+		if (!nb_slots || (size > MAX_PACKET))
+			return;
+
+		//a full channel drops the oldest packet
+		if (count == nb_slots)
+		{
+			first = (first + 1) % nb_slots;
+			count--;
+		}
+
+		PxU32 slot = (first + count) % nb_slots;
+		memcpy(&slots[slot*MAX_PACKET], packet, size);
+		sizes[slot] = size;
+		count++;
+		bytes_sent += size;
+	}
+
+	PxU32 LoopbackChannel::Receive(unsigned char* packet, PxU32 capacity)
+	{
+		if (!count)
+			return 0;
+
+		PxU32 size = sizes[first];
+		if (size <= capacity)
+			memcpy(packet, &slots[first*MAX_PACKET], size);
+		else
+			size = 0;
+
+		first = (first + 1) % (PxU32)sizes.size();
+		count--;
+		return size;
+	}
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "Snapshot.h"
+#include <vector>
+
+namespace VisualDebugger
+{
+	using namespace physx;
+
+	///Compact network encoding of the moving parts of a scene snapshot (for remote spectators)
+	///
+	///Only the dynamic actors and the cloths are sent: positions as fixed point, rotations as the smallest three
+	///quaternion components, cloth particles as fixed point in the cloth frame.
+	///Every packet is delta encoded against the newest state the spectator has acknowledged, or against the
+	///quantised course layout both sides start from. Unchanged values cost a single bit.
+	///Cloth particles fill the rest of a fixed byte budget per packet in a round robin, so the bandwidth stays
+	///bounded however much the cloth moves; particles left out keep their acknowledged state.
+	///Encoder and decoder allocate all of their memory on construction.
+	namespace SnapshotCodec
+	{
+		static const PxU32 MAX_PACKET = 1400;
+		//number of sent/received states kept as baselines
+		static const PxU32 HISTORY = 32;
+		//fixed point scales (units per metre) and smallest three scale
+		static const PxReal POSITION_SCALE = 512.f;
+		static const PxReal PARTICLE_SCALE = 256.f;
+		static const PxReal ROTATION_SCALE = 2047.f * 1.41421356f;
+
+		///Quantised pose of a moving actor or a cloth
+		struct QuantizedPose
+		{
+			PxI32 position[3];
+			PxU32 largest;
+			PxI32 rotation[3];
+		};
+
+		///Quantised state of all moving parts of a snapshot
+		struct QuantizedState
+		{
+			PxU16 sequence;
+			bool valid;
+			std::vector<QuantizedPose> poses;
+			std::vector<PxI32> particles;
+		};
+	}
+
+	///Encodes snapshots for a spectator
+	class SnapshotEncoder
+	{
+		PxU32 nb_poses, nb_particles;
+		PxU32 packet_budget;
+		SnapshotCodec::QuantizedState seed;
+		std::vector<SnapshotCodec::QuantizedState> history;
+		std::vector<PxI32> particles;
+		PxU16 sequence;
+		PxU16 baseline;
+		bool acknowledged;
+		PxU32 particle_cursor;
+
+	public:
+		///Create an encoder for snapshots with the structure of layout
+		///Each packet stays under packet_budget bytes (when it can hold the actor poses).
+		SnapshotEncoder(const SceneSnapshot& layout, PxU32 packet_budget=SnapshotCodec::MAX_PACKET);
+
+		///Encode a snapshot into a packet, returns the size of the packet (0 if the snapshot does not match the layout)
+		PxU32 Encode(const SceneSnapshot& snapshot, unsigned char* packet, PxU32 capacity);
+
+		///The spectator has received a packet: newer packets are encoded against it
+		void Acknowledge(PxU16 sequence);
+	};
+
+	///Decodes the packets of an encoder back into a snapshot
+	class SnapshotDecoder
+	{
+		PxU32 nb_poses, nb_particles;
+		SnapshotCodec::QuantizedState seed;
+		std::vector<SnapshotCodec::QuantizedState> history;
+		PxU16 latest;
+		bool received;
+
+	public:
+		///Create a decoder for snapshots with the structure of layout (the same course as the encoder)
+		SnapshotDecoder(const SceneSnapshot& layout);
+
+		///Decode a packet, returns false for packets that are malformed, out of date or have an unknown baseline
+		bool Decode(const unsigned char* packet, PxU32 size);
+
+		///Sequence number of the latest decoded packet (to acknowledge)
+		PxU16 Latest() { return latest; }
+
+		///Write the latest decoded state into a snapshot with the structure of the layout
+		void Apply(SceneSnapshot& snapshot);
+	};
+
+	///Unreliable packet channel to a spectator
+	class PacketChannel
+	{
+	public:
+		virtual ~PacketChannel() {}
+
+		///Send a packet (may be dropped)
+		virtual void Send(const unsigned char* packet, PxU32 size) = 0;
+
+		///Receive the next packet, returns its size (0 if there is none)
+		virtual PxU32 Receive(unsigned char* packet, PxU32 capacity) = 0;
+	};
+
+	///In-process channel, a stand-in for a local socket
+	///Packets go through a fixed ring of slots; when the ring is full the oldest packet is dropped.
+	class LoopbackChannel : public PacketChannel
+	{
+		std::vector<unsigned char> slots;
+		std::vector<PxU32> sizes;
+		PxU32 first, count;
+		PxU32 bytes_sent;
+
+	public:
+		LoopbackChannel(PxU32 nb_slots=8);
+
+		virtual void Send(const unsigned char* packet, PxU32 size);
+
+		virtual PxU32 Receive(unsigned char* packet, PxU32 capacity);
+
+		///Total number of bytes sent
+		PxU32 BytesSent() { return bytes_sent; }
+	};
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+
+namespace VisualDebugger
+{
+	///Lock-free triple buffer for a single producer and a single consumer
+	///The producer fills Back() and publishes it, the consumer picks up the latest published buffer with Update().
+	///Neither side ever waits: the producer overwrites unread buffers and the consumer keeps the last one.
+	template<class T>
+	class TripleBuffer
+	{
+		static const unsigned int INDEX = 3;
+		static const unsigned int FRESH = 4;
+
+		T buffers[3];
+		//index of the buffer in the middle, FRESH when it has been published and not read yet
+		std::atomic<unsigned int> middle;
+		unsigned int back, front;
+
+		TripleBuffer(const TripleBuffer&);
+		TripleBuffer& operator=(const TripleBuffer&);
+
+	public:
+		TripleBuffer() : middle(1), back(0), front(2)
+		{
+		}
+
+		///Buffer owned by the producer (holds stale content, overwrite all of it)
+		T& Back()
+		{
+			return buffers[back];
+		}
+
+		///Publish the back buffer
+		void Publish()
+		{
+			back = middle.exchange(back | FRESH) & INDEX;
+		}
+
+		///Pick up the latest published buffer, false if nothing new was published
+		bool Update()
+		{
+			if (!(middle.load() & FRESH))
+				return false;
+			front = middle.exchange(front) & INDEX;
+			return true;
+		}
+
+		///Buffer owned by the consumer
+		const T& Front() const
+		{
+			return buffers[front];
+		}
+	};
+}
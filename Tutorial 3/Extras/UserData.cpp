@@ -0,0 +1,113 @@
+#include "UserData.h"
+#include "..\Exception.h"
+
+using namespace physx;
+
+bool RenderComponents::Valid(RenderHandle handle) const
+{
+	PxU32 index = handle & INDEX_MASK;
+	return handle && (index < generations.size()) && (generations[index] == (handle >> INDEX_BITS));
+}
+
+RenderHandle RenderComponents::Create(const PxVec3& color, const PxVec3* palette, const PxClothMeshDesc* cloth_mesh_desc)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	PxU32 index;
+	if (free_slots.size())
+	{
+		index = free_slots.back();
+		free_slots.pop_back();
+	}
+	else
+	{
+		index = (PxU32)colors.size();
+		if (index > INDEX_MASK)
+			throw new Exception("RenderComponents::Create, Too many render components.");
+		colors.push_back(color);
+		palettes.push_back(0);
+		cloth_mesh_descs.push_back(0);
+		generations.push_back(0);
+	}
+
+	//a new generation for every use of the slot, 0 is skipped so that no handle is 0
+	PxU32 generation = (generations[index] + 1) & (0xffffffff >> INDEX_BITS);
+	generations[index] = generation ? generation : 1;
+
+	colors[index] = color;
+	palettes[index] = palette;
+	cloth_mesh_descs[index] = cloth_mesh_desc;
+	version++;
+	return (generations[index] << INDEX_BITS) | index;
+}
+
+void RenderComponents::Release(RenderHandle handle)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (!Valid(handle))
+		return;
+
+	PxU32 index = handle & INDEX_MASK;
+	//the generation of a free slot matches no handle
+	generations[index] = (generations[index] + 1) & (0xffffffff >> INDEX_BITS);
+	palettes[index] = 0;
+	cloth_mesh_descs[index] = 0;
+	free_slots.push_back(index);
+	version++;
+}
+
+void RenderComponents::Color(RenderHandle handle, const PxVec3& color)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (Valid(handle) && (colors[handle & INDEX_MASK] != color))
+	{
+		colors[handle & INDEX_MASK] = color;
+		version++;
+	}
+}
+
+PxVec3 RenderComponents::Color(RenderHandle handle)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return Valid(handle) ? colors[handle & INDEX_MASK] : PxVec3(0.f);
+}
+
+void RenderComponents::Palette(RenderHandle handle, const PxVec3* palette)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (Valid(handle) && (palettes[handle & INDEX_MASK] != palette))
+	{
+		palettes[handle & INDEX_MASK] = palette;
+		version++;
+	}
+}
+
+const PxVec3* RenderComponents::Palette(RenderHandle handle)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return Valid(handle) ? palettes[handle & INDEX_MASK] : 0;
+}
+
+const PxClothMeshDesc* RenderComponents::ClothMeshDesc(RenderHandle handle)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return Valid(handle) ? cloth_mesh_descs[handle & INDEX_MASK] : 0;
+}
+
+PxU32 RenderComponents::Size()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return (PxU32)(colors.size() - free_slots.size());
+}
+
+PxU32 RenderComponents::Version()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return version;
+}
+
+RenderComponents& GetRenderComponents()
+{
+	static RenderComponents components;
+	return components;
+}
@@ -1,14 +1,99 @@
 #pragma once
 
 #include "PxPhysicsAPI.h"
+#include <vector>
+#include <mutex>
 
 //add here any other structures that you want to pass from your simulation to the renderer
-class UserData
+
+///Handle of a render component, kept in the userData of a shape or a cloth
+///The low bits index the component arrays, the high bits count the reuses of the slot (0 is never a valid handle).
+typedef physx::PxU32 RenderHandle;
+
+///Render attributes of the shapes and cloths of all scenes
+///The attributes are stored as parallel arrays indexed by the handle, so they do not move when components are added
+///and a snapshot reads them without following pointers into the actors. Slots of released components are reused.
+///All access is synchronised, scenes on different threads share the store.
+class RenderComponents
 {
+	std::vector<physx::PxVec3> colors;
+	//per material slot colours of a triangle mesh (indexed by the triangle material index)
+	std::vector<const physx::PxVec3*> palettes;
+	std::vector<const physx::PxClothMeshDesc*> cloth_mesh_descs;
+	std::vector<physx::PxU32> generations;
+	std::vector<physx::PxU32> free_slots;
+	//changes with every added or released component and every new colour or palette
+	physx::PxU32 version;
+	std::mutex mutex;
+
+	bool Valid(RenderHandle handle) const;
+
 public:
-	physx::PxVec3* color;
-	physx::PxClothMeshDesc* cloth_mesh_desc;
+	static const physx::PxU32 INDEX_BITS = 20;
+	static const physx::PxU32 INDEX_MASK = (1 << INDEX_BITS) - 1;
+
+	RenderComponents() : version(0) {}
+
+	///Add a component (the palette and the mesh description are not copied, they have to outlive the component)
+	RenderHandle Create(const physx::PxVec3& color, const physx::PxVec3* palette=0, const physx::PxClothMeshDesc* cloth_mesh_desc=0);
+
+	///Release a component (stale handles are ignored)
+	void Release(RenderHandle handle);
+
+	///Set the colour of a component
+	void Color(RenderHandle handle, const physx::PxVec3& color);
+
+	///Get the colour of a component (black for stale handles)
+	physx::PxVec3 Color(RenderHandle handle);
+
+	///Set the palette of a component
+	void Palette(RenderHandle handle, const physx::PxVec3* palette);
+
+	///Get the palette of a component (0 if it has none)
+	const physx::PxVec3* Palette(RenderHandle handle);
+
+	///Get the cloth mesh description of a component (0 if it has none)
+	const physx::PxClothMeshDesc* ClothMeshDesc(RenderHandle handle);
+
+	///Number of live components
+	physx::PxU32 Size();
 
-	UserData(physx::PxVec3* _color=0, physx::PxClothMeshDesc* _cloth_mesh_desc=0) :
-		color(_color), cloth_mesh_desc(_cloth_mesh_desc) {}
-};
\ No newline at end of file
+	///Changes whenever a component is added or released or gets a new colour or palette
+	physx::PxU32 Version();
+
+	///Read access to many components under a single lock (held while the reader exists)
+	class Reader
+	{
+		std::lock_guard<std::mutex> lock;
+		const RenderComponents& store;
+
+	public:
+		Reader(RenderComponents& components) : lock(components.mutex), store(components) {}
+
+		bool Valid(RenderHandle handle) const { return store.Valid(handle); }
+
+		const physx::PxVec3& Color(RenderHandle handle) const { return store.colors[handle & INDEX_MASK]; }
+
+		const physx::PxVec3* Palette(RenderHandle handle) const { return store.palettes[handle & INDEX_MASK]; }
+
+		const physx::PxClothMeshDesc* ClothMeshDesc(RenderHandle handle) const { return store.cloth_mesh_descs[handle & INDEX_MASK]; }
+
+		///Changes whenever a component is added or released or gets a new colour or palette
+		physx::PxU32 Version() const { return store.version; }
+	};
+};
+
+///The render components of all scenes
+RenderComponents& GetRenderComponents();
+
+///The render handle kept in a userData pointer
+inline RenderHandle GetRenderHandle(const void* user_data)
+{
+	return (RenderHandle)(size_t)user_data;
+}
+
+///A render handle as a userData pointer
+inline void* RenderUserData(RenderHandle handle)
+{
+	return (void*)(size_t)handle;
+}
@@ -0,0 +1,155 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+#include "VertexBuffer.h"
+#include <cstring>
+
+#ifndef _WIN32
+#include <GL/glx.h>
+#endif
+
+#ifdef RENDERER_OSMESA
+#include <GL/osmesa.h>
+#endif
+
+namespace VisualDebugger
+{
+	GLProc GetGLProcAddress(const char* name)
+	{
+#ifdef RENDERER_OSMESA
+		//an offscreen context does not come from the window system
+		if (OSMesaGetCurrentContext())
+			return (GLProc)OSMesaGetProcAddress(name);
+#endif
+#ifdef _WIN32
+		return (GLProc)wglGetProcAddress(name);
+#else
+		return (GLProc)glXGetProcAddressARB((const GLubyte*)name);
+#endif
+	}
+
+	typedef void (APIENTRY *GenBuffersProc)(GLsizei n, GLuint* buffers);
+	typedef void (APIENTRY *DeleteBuffersProc)(GLsizei n, const GLuint* buffers);
+	typedef void (APIENTRY *BindBufferProc)(GLenum target, GLuint buffer);
+	typedef void (APIENTRY *BufferDataProc)(GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+	typedef void* (APIENTRY *MapBufferProc)(GLenum target, GLenum access);
+	typedef GLboolean (APIENTRY *UnmapBufferProc)(GLenum target);
+
+	static GenBuffersProc glGenBuffersARB = 0;
+	static DeleteBuffersProc glDeleteBuffersARB = 0;
+	static BindBufferProc glBindBufferARB = 0;
+	static BufferDataProc glBufferDataARB = 0;
+	static MapBufferProc glMapBufferARB = 0;
+	static UnmapBufferProc glUnmapBufferARB = 0;
+	static bool pixel_buffers = false;
+
+	///Load the buffer object entry points (needs a current GL context)
+	static bool LoadExtension()
+	{
+		static bool loaded = false;
+		static bool supported = false;
+
+		if (loaded)
+			return supported;
+
+		const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+		if (!extensions)
+			return false;
+
+		loaded = true;
+
+		if (!strstr(extensions, "GL_ARB_vertex_buffer_object"))
+			return false;
+
+		glGenBuffersARB = (GenBuffersProc)GetGLProcAddress("glGenBuffersARB");
+		glDeleteBuffersARB = (DeleteBuffersProc)GetGLProcAddress("glDeleteBuffersARB");
+		glBindBufferARB = (BindBufferProc)GetGLProcAddress("glBindBufferARB");
+		glBufferDataARB = (BufferDataProc)GetGLProcAddress("glBufferDataARB");
+		glMapBufferARB = (MapBufferProc)GetGLProcAddress("glMapBufferARB");
+		glUnmapBufferARB = (UnmapBufferProc)GetGLProcAddress("glUnmapBufferARB");
+
+		supported = glGenBuffersARB && glDeleteBuffersARB && glBindBufferARB && glBufferDataARB;
+		pixel_buffers = supported && glMapBufferARB && glUnmapBufferARB && strstr(extensions, "GL_ARB_pixel_buffer_object");
+		return supported;
+	}
+
+	bool VertexBuffer::Supported()
+	{
+		return LoadExtension();
+	}
+
+	bool VertexBuffer::PixelBuffersSupported()
+	{
+		return LoadExtension() && pixel_buffers;
+	}
+
+	VertexBuffer::VertexBuffer(GLenum _target)
+		: id(0), target(_target), size(0)
+	{
+	}
+
+	VertexBuffer::~VertexBuffer()
+	{
+		if (id)
+			glDeleteBuffersARB(1, &id);
+	}
+
+	void VertexBuffer::Data(const void* data, size_t data_size, GLenum usage)
+	{
+		size = data_size;
+
+		if (Supported())
+		{
+			if (!id)
+				glGenBuffersARB(1, &id);
+			glBindBufferARB(target, id);
+			glBufferDataARB(target, (ptrdiff_t)data_size, data, usage);
+			glBindBufferARB(target, 0);
+		}
+		else
+		{
+			client_data.resize(data_size);
+			if (data_size && data)
+				memcpy(&client_data.front(), data, data_size);
+		}
+	}
+
+	const char* VertexBuffer::Bind()
+	{
+		if (id)
+		{
+			glBindBufferARB(target, id);
+			return 0;
+		}
+		return client_data.size() ? &client_data.front() : 0;
+	}
+
+	void* VertexBuffer::Map(GLenum access)
+	{
+		if (id)
+		{
+			if (!glMapBufferARB)
+				return 0;
+			glBindBufferARB(target, id);
+			return glMapBufferARB(target, access);
+		}
+		return client_data.size() ? &client_data.front() : 0;
+	}
+
+	void VertexBuffer::Unmap()
+	{
+		if (id && glUnmapBufferARB)
+		{
+			glUnmapBufferARB(target);
+			glBindBufferARB(target, 0);
+		}
+	}
+
+	void VertexBuffer::Unbind(GLenum target)
+	{
+		if (Supported())
+			glBindBufferARB(target, 0);
+	}
+}
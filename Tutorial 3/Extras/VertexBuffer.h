@@ -0,0 +1,77 @@
+#pragma once
+
+#include <GL/glut.h>
+#include <vector>
+#include <cstddef>
+
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER 0x8892
+#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#define GL_STREAM_DRAW 0x88E0
+#define GL_STATIC_DRAW 0x88E4
+#define GL_DYNAMIC_DRAW 0x88E8
+#endif
+
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#define GL_STREAM_READ 0x88E1
+#endif
+
+#ifndef GL_READ_ONLY
+#define GL_READ_ONLY 0x88B8
+#define GL_WRITE_ONLY 0x88B9
+#endif
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+namespace VisualDebugger
+{
+	typedef void (APIENTRY *GLProc)();
+
+	///Entry point of an extension function of the current context
+	GLProc GetGLProcAddress(const char* name);
+
+	///GPU buffer object (ARB_vertex_buffer_object)
+	///Falls back to client memory when the driver does not support buffer objects.
+	class VertexBuffer
+	{
+		GLuint id;
+		GLenum target;
+		size_t size;
+		std::vector<char> client_data;
+
+		VertexBuffer(const VertexBuffer&);
+		VertexBuffer& operator=(const VertexBuffer&);
+
+	public:
+		VertexBuffer(GLenum _target=GL_ARRAY_BUFFER);
+
+		~VertexBuffer();
+
+		///Upload data (replaces the previous content)
+		void Data(const void* data, size_t data_size, GLenum usage=GL_STATIC_DRAW);
+
+		///Bind the buffer and return the base pointer for gl*Pointer calls
+		const char* Bind();
+
+		///Map the buffer content into client memory (0 on failure), call Unmap when done
+		void* Map(GLenum access=GL_READ_ONLY);
+
+		///Unmap a mapped buffer
+		void Unmap();
+
+		///Unbind buffers of the given target
+		static void Unbind(GLenum target=GL_ARRAY_BUFFER);
+
+		///Size of the data in bytes
+		size_t Size() const { return size; }
+
+		///Check if buffer objects are supported by the driver
+		static bool Supported();
+
+		///Check if pixel buffer objects (GL_PIXEL_PACK_BUFFER) are supported by the driver
+		static bool PixelBuffersSupported();
+	};
+}
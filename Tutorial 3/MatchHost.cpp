@@ -0,0 +1,282 @@
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+#include "MatchHost.h"
+#include <exception>
+
+namespace PhysicsEngine
+{
+	//CPU time used by the calling thread so far (in seconds)
+	static double ThreadCpuTime()
+	{
+#ifdef _WIN32
+		FILETIME creation_time, exit_time, kernel, user;
+		if (!GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel, &user))
+			return 0.;
+		//100 ns units
+		ULARGE_INTEGER k, u;
+		k.LowPart = kernel.dwLowDateTime; k.HighPart = kernel.dwHighDateTime;
+		u.LowPart = user.dwLowDateTime; u.HighPart = user.dwHighDateTime;
+		return (k.QuadPart + u.QuadPart) * 1e-7;
+#else
+		timespec time;
+		if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time))
+			return 0.;
+		return time.tv_sec + time.tv_nsec * 1e-9;
+#endif
+	}
+
+	MatchHost::MatchHost(PxU32 _nb_threads)
+		: next_id(0), nb_threads(PxMax(_nb_threads, (PxU32)1)), running(false)
+	{
+		if (!GetPhysics() || !GetDispatcher())
+			throw new Exception("MatchHost::MatchHost, PhysX has to be initialised first.");
+	}
+
+	MatchHost::~MatchHost()
+	{
+		Stop();
+
+		for (std::map<PxU32, Match*>::iterator it = matches.begin(); it != matches.end(); it++)
+			Release(it->second);
+		matches.clear();
+	}
+
+	PxU32 MatchHost::Create(const string& course_file, PxReal rate)
+	{
+		if (rate <= 0.f)
+			throw new Exception("MatchHost::Create, The rate has to be positive.");
+
+		Match* match = new Match();
+		match->scene = new MyScene(course_file);
+		match->step_time = 1.f/rate;
+		match->removed = false;
+
+		{
+			std::lock_guard<std::mutex> scene_lock(scene_mutex);
+			try
+			{
+				match->scene->Init();
+			}
+			catch (...)
+			{
+				delete match->scene;
+				delete match;
+				throw;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		PxU32 id = next_id++;
+		match->due = Clock::now();
+		matches[id] = match;
+		schedule.push(Entry(match->due, id));
+		wakeup.notify_one();
+		return id;
+	}
+
+	void MatchHost::Remove(PxU32 id)
+	{
+		Match* match = 0;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			std::map<PxU32, Match*>::iterator it = matches.find(id);
+			if (it == matches.end())
+				return;
+
+			//a running host drops the match the next time it comes up (failed matches are not scheduled any more)
+			if (running && !it->second->stats.failed)
+			{
+				it->second->removed = true;
+				return;
+			}
+
+			match = it->second;
+			matches.erase(it);
+		}
+		Release(match);
+	}
+
+	void MatchHost::Post(PxU32 id, const Command& command)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::map<PxU32, Match*>::iterator it = matches.find(id);
+		if (it == matches.end())
+			throw new Exception("MatchHost::Post, Unknown match.");
+		it->second->commands.push_back(command);
+	}
+
+	MatchHost::MatchStats MatchHost::Stats(PxU32 id)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::map<PxU32, Match*>::iterator it = matches.find(id);
+		if (it == matches.end())
+			throw new Exception("MatchHost::Stats, Unknown match.");
+		return it->second->stats;
+	}
+
+	std::vector<PxU32> MatchHost::Matches()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		std::vector<PxU32> ids;
+		for (std::map<PxU32, Match*>::iterator it = matches.begin(); it != matches.end(); it++)
+			if (!it->second->removed)
+				ids.push_back(it->first);
+		return ids;
+	}
+
+	void MatchHost::Start()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (running)
+			return;
+		running = true;
+		for (PxU32 i = 0; i < nb_threads; i++)
+			threads.push_back(std::thread(&MatchHost::HostLoop, this));
+	}
+
+	void MatchHost::Stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!running)
+				return;
+			running = false;
+			wakeup.notify_all();
+		}
+
+		for (PxU32 i = 0; i < threads.size(); i++)
+			threads[i].join();
+		threads.clear();
+
+		//release the matches removed while running
+		std::vector<Match*> removed;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			for (std::map<PxU32, Match*>::iterator it = matches.begin(); it != matches.end();)
+			{
+				if (it->second->removed)
+				{
+					removed.push_back(it->second);
+					it = matches.erase(it);
+				}
+				else
+					it++;
+			}
+		}
+		for (PxU32 i = 0; i < removed.size(); i++)
+			Release(removed[i]);
+	}
+
+	//Host thread: step the match that is due first, sleep while none is due
+	void MatchHost::HostLoop()
+	{
+		std::vector<Command> commands;
+		std::unique_lock<std::mutex> lock(mutex);
+		while (running)
+		{
+			if (schedule.empty())
+			{
+				wakeup.wait(lock);
+				continue;
+			}
+
+			Entry next = schedule.top();
+			if (Clock::now() < next.first)
+			{
+				wakeup.wait_until(lock, next.first);
+				continue;
+			}
+			schedule.pop();
+
+			std::map<PxU32, Match*>::iterator it = matches.find(next.second);
+			if (it == matches.end())
+				continue;
+			Match* match = it->second;
+
+			if (!match->removed)
+			{
+				//the match is out of the schedule while it steps, so no other thread picks it up
+				commands.swap(match->commands);
+				MatchStats stats = match->stats;
+				lock.unlock();
+				Step(*match, commands, stats);
+				lock.lock();
+				match->stats = stats;
+			}
+
+			if (match->removed)
+			{
+				matches.erase(next.second);
+				lock.unlock();
+				Release(match);
+				lock.lock();
+				continue;
+			}
+
+			//a failed match keeps its stats for reporting, but is not stepped again
+			if (match->stats.failed)
+				continue;
+
+			//do not try to catch up after a stall
+			Clock::time_point now = Clock::now();
+			match->due += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<PxReal>(match->step_time));
+			if (match->due < now)
+				match->due = now;
+			schedule.push(Entry(match->due, next.second));
+		}
+	}
+
+	//Run the posted commands and perform a single simulation step of a match
+	void MatchHost::Step(Match& match, std::vector<Command>& commands, MatchStats& stats)
+	{
+		Clock::time_point start = Clock::now();
+		double cpu_start = ThreadCpuTime();
+		if (std::chrono::duration<PxReal>(start - match.due).count() > match.step_time)
+			stats.late_steps++;
+
+		//an error only stops its own match, the host thread goes on with the others
+		try
+		{
+			for (PxU32 i = 0; i < commands.size(); i++)
+				commands[i](*match.scene);
+			commands.clear();
+
+			match.scene->Update(match.step_time);
+		}
+		catch (Exception* exc)
+		{
+			commands.clear();
+			stats.failed = true;
+			stats.error = exc->what();
+			delete exc;
+			return;
+		}
+		catch (std::exception& exc)
+		{
+			commands.clear();
+			stats.failed = true;
+			stats.error = exc.what();
+			return;
+		}
+
+		PxReal step_time = std::chrono::duration<PxReal>(Clock::now() - start).count();
+		stats.steps++;
+		stats.wall_time += step_time;
+		stats.host_cpu_time += (PxReal)(ThreadCpuTime() - cpu_start);
+		stats.max_step_time = PxMax(stats.max_step_time, step_time);
+		stats.simulate_time += match.scene->SimulateTime();
+		stats.fetch_time += match.scene->FetchTime();
+	}
+
+	void MatchHost::Release(Match* match)
+	{
+		std::lock_guard<std::mutex> scene_lock(scene_mutex);
+		delete match->scene;
+		delete match;
+	}
+}
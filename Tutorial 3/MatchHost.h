@@ -0,0 +1,106 @@
+#pragma once
+
+#include "MyPhysicsEngine.h"
+#include <functional>
+#include <map>
+#include <queue>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+
+namespace PhysicsEngine
+{
+	///Host for many independent matches in one process
+	///
+	///All matches share the PxPhysics object, the material registry and the worker pool created by PxInit.
+	///Every match steps on its own schedule on one of the host threads and is driven only by posted commands,
+	///so no match depends on a window, a camera or the keyboard.
+	class MatchHost
+	{
+	public:
+		///A command runs on the host thread of the match, right before its next step
+		typedef std::function<void(MyScene&)> Command;
+
+		///Time accounting of a match (in seconds)
+		struct MatchStats
+		{
+			PxU32 steps;
+			//steps that started more than a step late (the schedule is not caught up)
+			PxU32 late_steps;
+			//wall time of running commands and stepping, including waiting for tasks of all matches in the shared worker pool
+			PxReal wall_time;
+			//CPU time of the host thread for the same work (the simulation tasks run on the shared worker pool and are not included)
+			PxReal host_cpu_time;
+			PxReal max_step_time;
+			PxReal simulate_time, fetch_time;
+			//a command or a step threw, the match is not stepped any more (error is the message)
+			bool failed;
+			string error;
+
+			MatchStats() : steps(0), late_steps(0), wall_time(0.f), host_cpu_time(0.f), max_step_time(0.f), simulate_time(0.f), fetch_time(0.f), failed(false) {}
+		};
+
+	private:
+		typedef std::chrono::high_resolution_clock Clock;
+
+		struct Match
+		{
+			MyScene* scene;
+			PxReal step_time;
+			Clock::time_point due;
+			std::vector<Command> commands;
+			MatchStats stats;
+			bool removed;
+		};
+
+		//a scheduled step: due time and match id, the earliest step first
+		typedef std::pair<Clock::time_point, PxU32> Entry;
+		typedef std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > Schedule;
+
+		std::map<PxU32, Match*> matches;
+		Schedule schedule;
+		PxU32 next_id;
+		std::vector<std::thread> threads;
+		PxU32 nb_threads;
+		bool running;
+		//guards the matches, the schedule and the command queues
+		std::mutex mutex;
+		std::condition_variable wakeup;
+		//serialises creating and releasing scenes
+		std::mutex scene_mutex;
+
+		void HostLoop();
+		void Step(Match& match, std::vector<Command>& commands, MatchStats& stats);
+		void Release(Match* match);
+
+	public:
+		///Host matches on nb_threads threads (PxInit has to be called first)
+		MatchHost(PxU32 nb_threads=1);
+
+		///Stop the host and release all matches
+		~MatchHost();
+
+		///Create a match stepping rate times per second, returns its id
+		PxU32 Create(const string& course_file, PxReal rate=60.f);
+
+		///Remove a match (after its current step), failed matches are kept until they are removed
+		void Remove(PxU32 id);
+
+		///Queue a command for a match
+		void Post(PxU32 id, const Command& command);
+
+		///Get the time accounting of a match
+		MatchStats Stats(PxU32 id);
+
+		///Ids of all matches
+		std::vector<PxU32> Matches();
+
+		///Start stepping the matches
+		void Start();
+
+		///Stop stepping the matches (the matches are kept)
+		void Stop();
+	};
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "BasicActors.h"
+#include "Course.h"
+#include "ActorPool.h"
 #include <iostream>
 #include <iomanip>
 
@@ -68,33 +70,139 @@ namespace PhysicsEngine
 		virtual void onSleep(PxActor **actors, PxU32 count) {}
 	};
 
+	///Material values replacing a material of the course (negative values keep the value of the course)
+	struct MaterialParameters
+	{
+		PxReal static_friction, dynamic_friction, restitution;
+
+		MaterialParameters() : static_friction(-1.f), dynamic_friction(-1.f), restitution(-1.f) {}
+	};
+
+	///Tunable physics parameters of the game
+	struct GameParameters
+	{
+		MaterialParameters concrete, asphalt;
+		PxReal ball_damping, ball_radius;
+
+		GameParameters() : ball_damping(.1f), ball_radius(.35f) {}
+	};
+
 	///Custom scene class
 	class MyScene : public Scene
 	{
 		MySimulationEventCallback* my_callback;
-		Sphere* ball, *ballCopy;
-		Club* club, *clubCopy;
-		Box* clubRot, *clubRotCopy;
-		Course* course;
-		CourseMiddle* courseMiddle;
-		TeeBox* teeBox;
-		Barriers* barriers;
-		RevoluteJoint* clubJoint, *clubJointCopy;
-		Windmill* windmill;
-		Sails* sails;
-		Box* sailRot;
-		RevoluteJoint* sailJoint;
-		Cloth* flag, *flagCopy;
-		Capsule* flagPole;
+		//base classes, so the members can also hold the copies made by Clone
+		Actor* ball, *club, *clubRot, *flag;
+		Joint* clubJoint;
+		//practice balls dropped in front of the club
+		ActorPool<Sphere>* practice_balls;
+		CourseLayout* layout;
+		string course_file;
+		//merge the static boxes of the course into one triangle mesh (see CourseLayout)
+		bool merge_static;
+		Actor* sails;
+		Actor* flagPole;
 		PxMaterial* concrete, *asphalt;
+		GameParameters parameters;
 
 		bool win = false;
+		bool announce = true;
+		//the ball is holed once it drops below the centre height inside the square around the centre
+		PxVec3 hole_center = PxVec3(0.f, -0.5f, 50.f);
+		PxReal hole_size = 1.f;
 		PxTransform ballInitTransform, clubInitTransform, clubRotInitTransform, sailsInitTransform, flagPoleInitTransform;
 		
 	public:
+		static const PxU32 PRACTICE_BALLS = 16;
+
 		//specify your custom filter shader here
 		//PxDefaultSimulationFilterShader by default
-		MyScene() : Scene() {};
+		MyScene(const string& _course_file="Courses\\Hole1.course", const GameParameters& _parameters=GameParameters(), bool _merge_static=true) : Scene(),
+			my_callback(0), ball(0), club(0), clubRot(0), flag(0), clubJoint(0), practice_balls(0), layout(0), course_file(_course_file), merge_static(_merge_static), sails(0), flagPole(0),
+			concrete(0), asphalt(0), parameters(_parameters) {};
+
+		~MyScene()
+		{
+			ReleaseActors();
+		}
+
+		template<class T> static void ReleaseActor(T*& actor)
+		{
+			if (!actor)
+				return;
+			PxActor* px_actor = actor->Get();
+			delete actor;
+			px_actor->release();
+			actor = 0;
+		}
+
+		///Replace a material on all shapes of the scene
+		void ReplaceMaterial(PxMaterial* from, PxMaterial* to)
+		{
+			std::vector<PxActor*> actors = GetAllActors();
+			std::vector<PxShape*> shapes;
+			std::vector<PxMaterial*> materials;
+			for (PxU32 i = 0; i < actors.size(); i++)
+			{
+				if (!actors[i]->isRigidActor())
+					continue;
+				PxRigidActor* actor = (PxRigidActor*)actors[i];
+				shapes.resize(actor->getNbShapes());
+				actor->getShapes(shapes.data(), (PxU32)shapes.size());
+				for (PxU32 j = 0; j < shapes.size(); j++)
+				{
+					materials.resize(shapes[j]->getNbMaterials());
+					shapes[j]->getMaterials(materials.data(), (PxU32)materials.size());
+					bool changed = false;
+					for (PxU32 k = 0; k < materials.size(); k++)
+						if (materials[k] == from)
+						{
+							materials[k] = to;
+							changed = true;
+						}
+					if (changed)
+						shapes[j]->setMaterials(materials.data(), (PxU16)materials.size());
+				}
+			}
+		}
+
+		///The material of the tuned parameters (or the material of the course)
+		PxMaterial* CustomMaterial(PxMaterial* material, const MaterialParameters& values)
+		{
+			if ((values.static_friction < 0.f) && (values.dynamic_friction < 0.f) && (values.restitution < 0.f))
+				return material;
+			PxMaterial* custom = SharedMaterial(
+				(values.static_friction < 0.f) ? material->getStaticFriction() : values.static_friction,
+				(values.dynamic_friction < 0.f) ? material->getDynamicFriction() : values.dynamic_friction,
+				(values.restitution < 0.f) ? material->getRestitution() : values.restitution);
+			ReplaceMaterial(material, custom);
+			return custom;
+		}
+
+		///Release the actors and the course layout of the scene
+		void ReleaseActors()
+		{
+			delete layout;
+			layout = 0;
+
+			if (clubJoint)
+				clubJoint->Get()->release();
+			delete clubJoint;
+			clubJoint = 0;
+
+			delete practice_balls;
+			practice_balls = 0;
+
+			ReleaseActor(ball);
+			ReleaseActor(club);
+			ReleaseActor(clubRot);
+			ReleaseActor(flag);
+
+			if (px_scene)
+				px_scene->setSimulationEventCallback(0);
+			delete my_callback;
+			my_callback = 0;
+		}
 
 		///A custom scene class
 		void SetVisualisation()
@@ -108,178 +216,130 @@ namespace PhysicsEngine
 		//Custom scene initialisation
 		virtual void CustomInit() 
 		{
-			SetVisualisation();			
+			//actors of a previous initialisation (reset)
+			ReleaseActors();
 
-			GetMaterial()->setDynamicFriction(.2f);
+			SetVisualisation();			
 
 			///Initialise and set the customised event callback
 			my_callback = new MySimulationEventCallback();
 			px_scene->setSimulationEventCallback(my_callback);
 
+			//the course layout (materials, static geometry, windmill and flag pole) is loaded from a course file
+			//see Courses\Hole1.course for the format
+			club = new Club(PxTransform(PxVec3(0.f, 0.f, 0.f), PxQuat(0.f, PxVec3(1.f, 0.f, 0.f))));
+			club->Color(PxVec3(0.f, 0.f, 1.f));
+
+			clubRot = new Box(PxTransform(PxVec3(0.f, 20.f, 0.f)));
+			((PxRigidDynamic*)clubRot->Get())->setRigidDynamicFlag(PxRigidDynamicFlag::eKINEMATIC, true);
+			((PxRigidBody*)clubRot->Get())->setActorFlag(PxActorFlag::eDISABLE_GRAVITY, true);
+			clubRot->Color(PxVec3(1.f, 1.f, 1.f));
+			clubRotInitTransform = ((PxRigidBody*)clubRot->Get())->getGlobalPose();
+
+			RevoluteJoint* revolute = new RevoluteJoint(
+				clubRot,
+				PxTransform(PxVec3(0.f, -10.f, 0.f),
+					PxQuat(PxPi / 2, PxVec3(1.f, 0.f, 0.f))),
+				club,
+				PxTransform(PxVec3(0.f, 9.5f, 0.f)));
+
+			revolute->SetLimits(-PxPi / 2 - PxPi / 4, PxPi / 2 - (2 * PxPi) / 3);
+			clubJoint = revolute;
+
+			ball = new Sphere(PxTransform(PxVec3(0.f, 0.1f, 1.f)), parameters.ball_radius);
+			((PxRigidBody*)ball->Get())->setGlobalPose(PxTransform(PxVec3(0.f, 0.1f, 0.8f)));
+			ball->Color(PxVec3(1.0f, 1.f, 1.f));
+			((PxRigidDynamic*)ball->Get())->setLinearDamping(parameters.ball_damping);
+
+			Add(club);
+			Add(clubRot);
+			Add(ball);
+
+			layout = new CourseLayout(this, course_file, PxTransform(PxIdentity), merge_static);
+
 			//							Static		Sliding
 			// Rubber on Dry Concrete	0.6 - 0.85	0.6 - 0.85
 			// Rubber on Dry Asphalt	0.5 - 0.8	0.5	- 0.8
 			// https://www.engineeringtoolbox.com/friction-coefficients-d_778.html
 			// http://www.engineershandbook.com/Tables/frictioncoefficients.htm
 			// http://www.roymech.co.uk/Useful_Tables/Tribology/co_of_frict.htm
-			concrete = GetPhysics()->createMaterial(0.6f, 0.6f, 0.4f); // static friction, dynamic friction, restitution
-			asphalt = GetPhysics()->createMaterial(0.5f, 0.5f, 0.7f);
+			concrete = layout->GetMaterial("concrete");
+			asphalt = layout->GetMaterial("asphalt");
+			sails = layout->GetActor("sails");
+			flagPole = layout->GetActor("flagPole");
 
-			for (int i = 0; i < 1; i++)//	DUPLICATE ENTIRE COURSE
-			{
-				course = new Course(PxTransform(PxVec3(0.f, 0.f, 0.f), PxQuat(0.f, PxVec3(0.f, 0.f, 0.f))));
-				course->Material(concrete);
-				course->Color(PxVec3(0.5f, 0.5f, 0.5f));
-
-				courseMiddle = new CourseMiddle(PxTransform(PxVec3(0.f, 0.f, 0.f), PxQuat(0.f, PxVec3(0.f, 0.f, 0.f))));
-				courseMiddle->Material(asphalt);
-				courseMiddle->Color(PxVec3(0.f, 0.f, 0.f));
-
-				teeBox = new TeeBox(PxTransform(PxVec3(0.f, 0.f, 0.f), PxQuat(0.f, PxVec3(0.f, 0.f, 0.f))));
-				teeBox->Color(PxVec3(1.f, 0.75f, 0.75f));
-
-				barriers = new Barriers(PxTransform(PxVec3(0.f, 0.f, 0.f), PxQuat(0.f, PxVec3(0.f, 0.f, 0.f))));
-				barriers->Color(PxVec3(0.75f, 0.75f, 1.f));
-
-				windmill = new Windmill(PxTransform(PxVec3(0.f, 0.f, 0.f), PxQuat(0.f, PxVec3(0.f, 0.f, 0.f))));
-				windmill->Color(PxVec3(0.75, 0.5f, 0.5f));
-
-				club = new Club(PxTransform(PxVec3(0.f, 0.f, 0.f), PxQuat(0.f, PxVec3(1.f, 0.f, 0.f))));
-				club->Color(PxVec3(0.f, 0.f, 1.f));
-				clubInitTransform = ((PxRigidBody*)club->Get())->getGlobalPose();
-
-				clubRot = new Box(PxTransform(PxVec3(0.f, 20.f, 0.f)));
-				clubRot->SetKinematic(true);
-				((PxRigidBody*)clubRot->Get())->setActorFlag(PxActorFlag::eDISABLE_GRAVITY, true);
-				clubRot->Color(PxVec3(1.f, 1.f, 1.f));
-				clubRotInitTransform = ((PxRigidBody*)clubRot->Get())->getGlobalPose();
-
-				clubJoint = new RevoluteJoint(
-					clubRot,
-					PxTransform(PxVec3(0.f, -10.f, 0.f),
-						PxQuat(PxPi / 2, PxVec3(1.f, 0.f, 0.f))),
-					club,
-					PxTransform(PxVec3(0.f, 9.5f, 0.f)));
-
-				clubJoint->SetLimits(-PxPi / 2 - PxPi / 4, PxPi / 2 - (2 * PxPi) / 3);
-
-				sails = new Sails(PxTransform(PxVec3(0.f, 0.f, 0.f), PxQuat(0.f, PxVec3(0.f, 0.f, 0.f))));
-				sails->Color(PxVec3(1.f, 0.9f, 0.9f));
-				((PxRigidBody*)sails->Get())->setActorFlag(PxActorFlag::eDISABLE_GRAVITY, true);
-
-				sailRot = new Box(PxTransform(PxVec3(0.f, 9.25f, 25.5f)));
-				sailRot->SetKinematic(true);
-				sailRot->Color(PxVec3(0.75, 0.5f, 0.5f));
-
-				sailJoint = new RevoluteJoint(
-					sailRot,
-					PxTransform(PxVec3(0.f, 0.f, 0.f),
-						PxQuat(PxPi / 2, PxVec3(0.f, 1.f, 0.f))),
-					sails,
-					PxTransform(PxVec3(0.f, 9.25f, 25.5f),
-						PxQuat(PxPi / 2, PxVec3(0.f, 1.f, 0.f))));
-				sailJoint->DriveVelocity(1.f);
-
-				ball = new Sphere(PxTransform(PxVec3(0.f, 0.1f, 1.f)), 0.35f);
-				((PxRigidBody*)ball->Get())->setGlobalPose(PxTransform(PxVec3(0.f, 0.1f, 0.8f)));
-				ball->Color(PxVec3(1.0f, 1.f, 1.f));
-				ball->Material(concrete);
-				((PxRigidDynamic*)ball->Get())->setLinearDamping(0.1f);
-				ballInitTransform = ((PxRigidBody*)ball->Get())->getGlobalPose();
-
-				flag = new Cloth(PxTransform(PxVec3(0.f, 10.f, 50.f), PxQuat(PxPi / 2, PxVec3(0.f, 1.f, 0.f))), PxVec2(2.f, 2.f), 20, 20, true);
-				flag->Color(PxVec3(1.f, 0.f, 0.f));
-				((PxCloth*)flag->Get())->setExternalAcceleration(PxVec3(-10.0f, 5.0f, 0.0f));
-				((PxCloth*)flag->Get())->setGlobalPose(PxTransform(PxVec3(0.f, 10.f, 50.f), PxQuat(PxPi / 2, PxVec3(0.f, 0.f, 1.f))));
-
-				flagPole = new Capsule(PxTransform(PxIdentity), PxVec2(0.05f, 5.95f));
-				flagPole->Color(PxVec3(0.4f, 0.2f, 0.2f));
-				((PxRigidBody*)flagPole->Get())->setGlobalPose(PxTransform(PxVec3(0.f, 6.1f, 50.f), PxQuat(PxPi / 2, PxVec3(0.f, 0.f, 1.f))));
-				((PxRigidBody*)flagPole->Get())->setActorFlag(PxActorFlag::eDISABLE_GRAVITY, true);
-				((PxRigidBody*)flagPole->Get())->setActorFlag(PxActorFlag::eDISABLE_SIMULATION, true);
-
-				Add(course);
-				Add(courseMiddle);
-				Add(teeBox);
-				Add(barriers);
-				Add(club);
-				Add(clubRot);
-				Add(ball);
-				Add(windmill);
-				Add(sails);
-				Add(sailRot);
-				Add(flag);
-				Add(flagPole);
-
-				if (i == 0)
-				{
-					ballInitTransform = ((PxRigidBody*)ball->Get())->getGlobalPose();
-					clubInitTransform = ((PxRigidBody*)club->Get())->getGlobalPose();
-					sailsInitTransform = ((PxRigidBody*)sails->Get())->getGlobalPose();
-					flagPoleInitTransform = ((PxRigidBody*)flagPole->Get())->getGlobalPose();
-				}
-			}
+			if (!concrete || !asphalt || !sails || !flagPole)
+				throw new Exception("MyScene::CustomInit, " + course_file + " is missing concrete, asphalt, sails or flagPole.");
 
-			//		DUPLICATE OBJECTS
-			int dupe_number = 0;
-			PxReal dupe_offset_x = 0.f, dupe_offset_y = 1.5f, dupe_offset_z = -0.5f;
-			bool dupe_ball = 0;
-			bool dupe_club = 0;
-			bool dupe_flag = 0;
+			//tuned materials replace the materials of the course
+			concrete = CustomMaterial(concrete, parameters.concrete);
+			asphalt = CustomMaterial(asphalt, parameters.asphalt);
 
-			for (int i = 0; i < dupe_number; i++)
-			{
-				//	BALL
-				if (dupe_ball)
-				{
-					ballCopy = new Sphere(PxTransform(PxVec3(0.f, 0.1f, 1.f)), 0.35f);
-					((PxRigidBody*)ballCopy->Get())->setGlobalPose(PxTransform(PxVec3(
-						0.f + (dupe_offset_x * (i + 1)),
-						0.1f + (dupe_offset_y * (i + 1)),
-						0.8f + (dupe_offset_z * (i + 1)))));
-					ballCopy->Color(PxVec3(1.0f, 1.f, 1.f));
-					ballCopy->Material(concrete);
-					((PxRigidDynamic*)ballCopy->Get())->setLinearDamping(0.1f);
-					Add(ballCopy);
-				}
+			ball->Material(concrete);
 
-				//	CLUB
-				if (dupe_club)
-				{
-					clubCopy = new Club(PxTransform(PxVec3(0.f, 0.f, 0.f), PxQuat(0.f, PxVec3(1.f, 0.f, 0.f))));
-					clubCopy->Color(PxVec3(0.f, 0.f, 1.f));
-					clubRotCopy = new Box(PxTransform(PxVec3(0.f, 20.f, 0.f)));
-					clubRotCopy->SetKinematic(true);
-					((PxRigidBody*)clubRotCopy->Get())->setActorFlag(PxActorFlag::eDISABLE_GRAVITY, true);
-					clubRotCopy->Color(PxVec3(1.f, 1.f, 1.f));
-					clubJointCopy = new RevoluteJoint(
-						clubRotCopy,
-						PxTransform(PxVec3(
-							0.f + (dupe_offset_x * (i + 1)),
-							-10.f + (dupe_offset_y * (i + 1)),
-							0.f + (dupe_offset_z * (i + 1))),
-							PxQuat(PxPi / 2, PxVec3(1.f, 0.f, 0.f))),
-						clubCopy,
-						PxTransform(PxVec3(0.f, 9.5f, 0.f)));
-					clubJointCopy->SetLimits(-PxPi / 2 - PxPi / 4, PxPi / 2 - (2 * PxPi) / 3);
-					Add(clubCopy);
-					Add(clubRotCopy);
-				}
+			flag = new Cloth(PxTransform(PxVec3(0.f, 10.f, 50.f), PxQuat(PxPi / 2, PxVec3(0.f, 1.f, 0.f))), PxVec2(2.f, 2.f), 20, 20, true);
+			flag->Color(PxVec3(1.f, 0.f, 0.f));
+			((PxCloth*)flag->Get())->setExternalAcceleration(PxVec3(-10.0f, 5.0f, 0.0f));
+			((PxCloth*)flag->Get())->setGlobalPose(PxTransform(PxVec3(0.f, 10.f, 50.f), PxQuat(PxPi / 2, PxVec3(0.f, 0.f, 1.f))));
+			Add(flag);
 
-				//	FLAG
-				if (dupe_flag)
-				{
-					flagCopy = new Cloth(PxTransform(PxVec3(0.f, 10.f, 50.f), PxQuat(PxPi / 2, PxVec3(0.f, 1.f, 0.f))), PxVec2(2.f, 2.f), 20, 20, true);
-					flagCopy->Color(PxVec3(1.f, 0.f, 0.f));
-					((PxCloth*)flagCopy->Get())->setExternalAcceleration(PxVec3(-10.0f, 5.0f, 0.0f));
-					((PxCloth*)flagCopy->Get())->setGlobalPose(PxTransform(PxVec3(
-						0.f + (dupe_offset_x * (i + 1)),
-						10.f + (dupe_offset_y * (i + 1)),
-						50.f + (dupe_offset_z * (i + 1))),
-						PxQuat(PxPi / 2, PxVec3(0.f, 0.f, 1.f))));
-					Add(flagCopy);
-				}
+			ballInitTransform = ((PxRigidBody*)ball->Get())->getGlobalPose();
+			clubInitTransform = ((PxRigidBody*)club->Get())->getGlobalPose();
+			sailsInitTransform = ((PxRigidBody*)sails->Get())->getGlobalPose();
+			flagPoleInitTransform = ((PxRigidBody*)flagPole->Get())->getGlobalPose();
+
+			//the practice balls are created once and only added to the scene when dropped
+			practice_balls = new ActorPool<Sphere>(this, PRACTICE_BALLS, [this]()
+			{
+				Sphere* practice_ball = new Sphere(PxTransform(PxIdentity), parameters.ball_radius);
+				practice_ball->Color(PxVec3(1.f, 1.f, 0.f));
+				practice_ball->Material(concrete);
+				((PxRigidDynamic*)practice_ball->Get())->setLinearDamping(parameters.ball_damping);
+				return practice_ball;
+			});
+		}
+
+		///Copy of the scene for what-if simulations (see Scene::Clone)
+		///The copy has no course layout of its own, the layout actors and joints belong to the copied scene.
+		///Practice balls in play are copied as plain actors, the copy has no practice balls to drop.
+		virtual MyScene* Clone()
+		{
+			MyScene* copy = new MyScene(course_file, parameters, merge_static);
+			try
+			{
+				CloneInto(*copy);
+			}
+			catch (Exception*)
+			{
+				delete copy;
+				throw;
 			}
+
+			copy->SetVisualisation();
+			copy->my_callback = new MySimulationEventCallback();
+			copy->px_scene->setSimulationEventCallback(copy->my_callback);
+
+			//the game actors are released by the copy like the originals (the flag is missing from shot scenes)
+			copy->clubJoint = copy->Adopt(clubJoint->Get());
+			copy->ball = copy->Adopt(ball->Get());
+			copy->club = copy->Adopt(club->Get());
+			copy->clubRot = copy->Adopt(clubRot->Get());
+			copy->flag = flag ? copy->Adopt(flag->Get()) : 0;
+			copy->sails = copy->Cloned(sails->Get());
+			copy->flagPole = copy->Cloned(flagPole->Get());
+
+			copy->concrete = concrete;
+			copy->asphalt = asphalt;
+			copy->win = win;
+			copy->announce = announce;
+			copy->hole_center = hole_center;
+			copy->hole_size = hole_size;
+			copy->ballInitTransform = ballInitTransform;
+			copy->clubInitTransform = clubInitTransform;
+			copy->clubRotInitTransform = clubRotInitTransform;
+			copy->sailsInitTransform = sailsInitTransform;
+			copy->flagPoleInitTransform = flagPoleInitTransform;
+			return copy;
 		}
 
 		void simulationTesting()
@@ -320,16 +380,76 @@ namespace PhysicsEngine
 		void checkWinState()
 		{
 			PxVec3 p = ((PxRigidBody*)ball->Get())->getGlobalPose().p;
-			PxReal xMin = -1.0f, xMax = 1.0f, yMax = -0.5f, zMin = 49.0f, zMax = 51.0f;
-			if (win == false && p.y < yMax && p.x > xMin && p.x < xMax && p.z > zMin && p.z < zMax)
+			if (win == false && InHole(p))
 			{
 				win = true;
-				std::cout << "YOU WIN!" << std::endl;
+				if (announce)
+					std::cout << "YOU WIN!" << std::endl;
 			}
 		}
 
+		///Is a ball position inside the hole
+		bool InHole(const PxVec3& p)
+		{
+			return (p.y < hole_center.y) && (PxAbs(p.x - hole_center.x) < hole_size) && (PxAbs(p.z - hole_center.z) < hole_size);
+		}
+
+		///Centre of the hole
+		PxVec3 HoleCenter() { return hole_center; }
+
+		///Get the win state
+		bool Won() { return win; }
+
+		///Set the win state (after restoring a saved state)
+		void Won(bool value) { win = value; }
+
+		///Print a message when the ball is holed
+		void Announce(bool value) { announce = value; }
+
+		///Get the ball
+		PxRigidDynamic* Ball() { return (PxRigidDynamic*)ball->Get(); }
+
+		///Get the club head
+		PxRigidDynamic* ClubHead() { return (PxRigidDynamic*)club->Get(); }
+
+		///Get the course layout (0 for copies made by Clone)
+		CourseLayout* Layout() { return layout; }
+
+		///Move the club behind the ball (the club follows the ball from its starting position)
+		void placeClub()
+		{
+			PxVec3 offset = Ball()->getGlobalPose().p - ballInitTransform.p;
+
+			((PxRigidBody*)clubRot->Get())->setGlobalPose(PxTransform(clubRotInitTransform.p + offset, clubRotInitTransform.q));
+
+			PxRigidDynamic* club_actor = (PxRigidDynamic*)club->Get();
+			club_actor->setGlobalPose(PxTransform(clubInitTransform.p + offset, clubInitTransform.q));
+			club_actor->setLinearVelocity(PxVec3(0.f));
+			club_actor->setAngularVelocity(PxVec3(0.f));
+		}
+
+		///Drop a practice ball in front of the club (0 when all practice balls are in play)
+		PxRigidDynamic* SpawnPracticeBall()
+		{
+			if (!practice_balls)
+				return 0;
+
+			PxVec3 offset = ((PxRigidBody*)clubRot->Get())->getGlobalPose().p - clubRotInitTransform.p;
+			Sphere* practice_ball = practice_balls->Spawn(PxTransform(ballInitTransform.p + offset + PxVec3(0.f, 1.f, 0.f)));
+			return practice_ball ? (PxRigidDynamic*)practice_ball->Get() : 0;
+		}
+
+		///Return all practice balls to the pool
+		void DespawnPracticeBalls()
+		{
+			if (practice_balls)
+				practice_balls->DespawnAll();
+		}
+
 		void resetGame()
 		{
+			DespawnPracticeBalls();
+
 			((PxRigidBody*)ball->Get())->setGlobalPose(ballInitTransform);
 			((PxRigidBody*)ball->Get())->setLinearVelocity(PxVec3(0.f, 0.f, 0.f));
 			((PxRigidBody*)ball->Get())->setAngularVelocity(PxVec3(0.f, 0.f, 0.f));
@@ -0,0 +1,151 @@
+#include "ParameterSweep.h"
+#include <atomic>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+namespace PhysicsEngine
+{
+	//the value of a parameter by name (0 if there is no such parameter)
+	static PxReal* Parameter(GameParameters& parameters, const std::string& name)
+	{
+		if (name == "concrete.static_friction")
+			return &parameters.concrete.static_friction;
+		if (name == "concrete.dynamic_friction")
+			return &parameters.concrete.dynamic_friction;
+		if (name == "concrete.restitution")
+			return &parameters.concrete.restitution;
+		if (name == "asphalt.static_friction")
+			return &parameters.asphalt.static_friction;
+		if (name == "asphalt.dynamic_friction")
+			return &parameters.asphalt.dynamic_friction;
+		if (name == "asphalt.restitution")
+			return &parameters.asphalt.restitution;
+		if (name == "ball.damping")
+			return &parameters.ball_damping;
+		if (name == "ball.radius")
+			return &parameters.ball_radius;
+		return 0;
+	}
+
+	ParameterSweep::ParameterSweep(const std::string& _course_file)
+		: course_file(_course_file)
+	{
+	}
+
+	void ParameterSweep::Add(const SweepRange& range)
+	{
+		GameParameters parameters;
+		if (!Parameter(parameters, range.name))
+			throw new Exception("ParameterSweep::Add, Unknown parameter " + range.name + ".");
+		if (!range.count)
+			throw new Exception("ParameterSweep::Add, " + range.name + " needs at least one value.");
+		ranges.push_back(range);
+	}
+
+	PxU32 ParameterSweep::Combinations()
+	{
+		PxU32 combinations = 1;
+		for (PxU32 i = 0; i < ranges.size(); i++)
+			combinations *= ranges[i].count;
+		return combinations;
+	}
+
+	//the first range changes fastest
+	void ParameterSweep::Parameters(PxU32 combination, GameParameters& parameters, std::vector<PxReal>& values)
+	{
+		values.resize(ranges.size());
+		for (PxU32 i = 0; i < ranges.size(); i++)
+		{
+			const SweepRange& range = ranges[i];
+			PxU32 index = combination % range.count;
+			combination /= range.count;
+
+			values[i] = (range.count > 1) ? range.first + (range.last - range.first) * index / (range.count - 1) : range.first;
+			*Parameter(parameters, range.name) = values[i];
+		}
+	}
+
+	void ParameterSweep::Run(const Shot& shot, std::vector<SweepResult>& results, PxU32 nb_threads, PxReal step, PxReal max_time)
+	{
+		if (!GetPhysics())
+			throw new Exception("ParameterSweep::Run, PhysX has to be initialised first.");
+
+		if (!nb_threads)
+			nb_threads = PxMax(std::thread::hardware_concurrency(), 1u);
+
+		PxU32 combinations = Combinations();
+		results.resize(combinations);
+
+		//scenes are created and released one at a time, the simulations run in parallel
+		std::mutex scene_mutex;
+		Exception* error = 0;
+		std::atomic<PxU32> next(0);
+		std::vector<std::thread> threads;
+		for (PxU32 t = 0; t < PxMin(nb_threads, combinations); t++)
+		{
+			threads.push_back(std::thread([&]()
+			{
+				for (PxU32 i = next++; i < combinations; i = next++)
+				{
+					GameParameters parameters;
+					Parameters(i, parameters, results[i].values);
+
+					MyScene* scene = new MyScene(course_file, parameters);
+					try
+					{
+						{
+							std::lock_guard<std::mutex> lock(scene_mutex);
+							scene->Init();
+						}
+						PrepareShotScene(*scene);
+
+						PlayShot(*scene, shot, step, max_time, results[i].shot);
+					}
+					catch (Exception* exc)
+					{
+						//keep the first error and stop all threads
+						std::lock_guard<std::mutex> lock(scene_mutex);
+						if (!error)
+							error = exc;
+						else
+							delete exc;
+						next = combinations;
+					}
+
+					std::lock_guard<std::mutex> lock(scene_mutex);
+					delete scene;
+				}
+			}));
+		}
+		for (PxU32 t = 0; t < threads.size(); t++)
+			threads[t].join();
+
+		if (error)
+			throw error;
+	}
+
+	void ParameterSweep::WriteCSV(const std::string& file, const std::vector<SweepResult>& results)
+	{
+		std::ofstream output(file);
+		if (!output)
+			throw new Exception("ParameterSweep::WriteCSV, Could not open " + file + ".");
+
+		for (PxU32 i = 0; i < ranges.size(); i++)
+			output << ranges[i].name << ",";
+		output << "rest_x,rest_y,rest_z,time_to_rest,holed,lost,rested,distance" << std::endl;
+
+		for (PxU32 i = 0; i < results.size(); i++)
+		{
+			const SweepResult& result = results[i];
+			for (PxU32 j = 0; j < result.values.size(); j++)
+				output << result.values[j] << ",";
+			const ShotResult& shot = result.shot;
+			output << shot.rest_position.x << "," << shot.rest_position.y << "," << shot.rest_position.z << ",";
+			//no time when the shot ran out of time
+			if (shot.holed || shot.lost || shot.rested)
+				output << shot.time;
+			output << "," << (shot.holed ? 1 : 0) << "," << (shot.lost ? 1 : 0) << "," << (shot.rested ? 1 : 0) << "," << shot.distance << std::endl;
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "ShotOptimizer.h"
+#include <string>
+#include <vector>
+
+namespace PhysicsEngine
+{
+	///A swept parameter: count values evenly spaced from first to last
+	///Parameters: concrete.static_friction, concrete.dynamic_friction, concrete.restitution,
+	///asphalt.static_friction, asphalt.dynamic_friction, asphalt.restitution, ball.damping and ball.radius.
+	struct SweepRange
+	{
+		std::string name;
+		PxReal first, last;
+		PxU32 count;
+	};
+
+	///Outcome of a scripted shot for one combination of parameter values
+	struct SweepResult
+	{
+		std::vector<PxReal> values;
+		ShotResult shot;
+	};
+
+	///Plays a scripted shot for every combination of parameter values and reports the outcomes
+	///Every combination is a fresh scene (the ball radius changes the geometry), the combinations run in parallel.
+	class ParameterSweep
+	{
+		std::string course_file;
+		std::vector<SweepRange> ranges;
+
+		void Parameters(PxU32 combination, GameParameters& parameters, std::vector<PxReal>& values);
+
+	public:
+		ParameterSweep(const std::string& course_file);
+
+		///Add a swept parameter (throws for unknown parameters)
+		void Add(const SweepRange& range);
+
+		///Number of combinations of all ranges
+		PxU32 Combinations();
+
+		///Play the shot for every combination on nb_threads threads (all cores when 0, PxInit has to be called first)
+		void Run(const Shot& shot, std::vector<SweepResult>& results, PxU32 nb_threads=0, PxReal step=1.f/60.f, PxReal max_time=15.f);
+
+		///Write the results as CSV: the parameter values, the rest position, the time to rest (empty on a timeout) and whether the ball was holed, lost or came to rest
+		void WriteCSV(const std::string& file, const std::vector<SweepResult>& results);
+	};
+}
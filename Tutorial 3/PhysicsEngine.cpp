@@ -1,5 +1,8 @@
 #include "PhysicsEngine.h"
 #include <iostream>
+#include <chrono>
+#include <map>
+#include <mutex>
 
 namespace PhysicsEngine
 {
@@ -15,9 +18,15 @@ namespace PhysicsEngine
 	debugger::comm::PvdConnection* vd_connection = 0;
 	PxPhysics* physics = 0;
 	PxCooking* cooking = 0;
+	PxDefaultCpuDispatcher* dispatcher = 0;
+
+	//shared materials by static friction, dynamic friction and restitution
+	typedef std::pair<PxReal, std::pair<PxReal, PxReal> > MaterialKey;
+	std::map<MaterialKey, PxMaterial*> shared_materials;
+	std::mutex material_mutex;
 
 	///PhysX functions
-	void PxInit()
+	void PxInit(PxU32 nb_threads)
 	{
 		//foundation
 		if (!foundation)
@@ -43,23 +52,33 @@ namespace PhysicsEngine
 		if(!cooking)
 			throw new Exception("PhysicsEngine::PxInit, Could not initialise the cooking component.");
 
+		//worker pool
+		if (!dispatcher)
+			dispatcher = PxDefaultCpuDispatcherCreate(nb_threads);
+
+		if (!dispatcher)
+			throw new Exception("PhysicsEngine::PxInit, Could not create the worker pool.");
+
 		//visual debugger
 		if (!vd_connection)
 			vd_connection = PxVisualDebuggerExt::createConnection(physics->getPvdConnectionManager(), 
 			"localhost", 5425, 100, PxVisualDebuggerExt::getAllConnectionFlags());
 
-		//create a deafult material
-		CreateMaterial();
+		//create a deafult material (set once here, all scenes share it)
+		CreateMaterial(.0f, .2f, .0f);
 	}
 
 	void PxRelease()
 	{
 		if (vd_connection)
 			vd_connection->release();
+		if (dispatcher)
+			dispatcher->release();
 		if (cooking)
 			cooking->release();
 		if (physics) {
 			PxCloseExtensions();
+			shared_materials.clear();
 			physics->release();			
 		}
 		if (foundation)
@@ -76,6 +95,11 @@ namespace PhysicsEngine
 		return cooking;
 	}
 
+	PxCpuDispatcher* GetDispatcher()
+	{
+		return dispatcher;
+	}
+
 	PxMaterial* GetMaterial(PxU32 index)
 	{
 		std::vector<PxMaterial*> materials(physics->getNbMaterials());
@@ -90,9 +114,49 @@ namespace PhysicsEngine
 		return physics->createMaterial(sf, df, cr);
 	}
 
+	PxMaterial* SharedMaterial(PxReal sf, PxReal df, PxReal cr)
+	{
+		std::lock_guard<std::mutex> lock(material_mutex);
+		PxMaterial*& material = shared_materials[MaterialKey(sf, std::make_pair(df, cr))];
+		if (!material)
+			material = CreateMaterial(sf, df, cr);
+		return material;
+	}
+
+	PxHeightField* CreateHeightField(const PxReal* heights, PxU32 rows, PxU32 columns, PxReal& height_scale)
+	{
+		//use the full range of the 16 bit samples
+		PxReal max_height = 0.f;
+		for (PxU32 i = 0; i < rows*columns; i++)
+			max_height = PxMax(max_height, PxAbs(heights[i]));
+		height_scale = (max_height > 0.f) ? (max_height / 32767.f) : 1.f;
+
+		std::vector<PxHeightFieldSample> samples(rows*columns);
+		for (PxU32 i = 0; i < samples.size(); i++)
+		{
+			PxReal height = heights[i] / height_scale;
+			samples[i].height = (PxI16)(height + ((height >= 0.f) ? .5f : -.5f));
+		}
+
+		PxHeightFieldDesc desc;
+		desc.format = PxHeightFieldFormat::eS16_TM;
+		desc.nbRows = rows;
+		desc.nbColumns = columns;
+		desc.samples.data = &samples.front();
+		desc.samples.stride = sizeof(PxHeightFieldSample);
+
+		return physics->createHeightField(desc);
+	}
+
 	///Actor methods
 
-	///Constructor
+	Actor::~Actor()
+	{
+		RenderComponents& components = GetRenderComponents();
+		for (PxU32 i = 0; i < render_handles.size(); i++)
+			components.Release(render_handles[i]);
+	}
+
 	PxActor* Actor::Get()
 	{
 		return actor;
@@ -100,25 +164,26 @@ namespace PhysicsEngine
 
 	void Actor::Color(PxVec3 new_color, PxU32 shape_index)
 	{
+		RenderComponents& components = GetRenderComponents();
 		//change color of all shapes
 		if (shape_index == -1)
 		{
-			for (unsigned int i = 0; i < colors.size(); i++)
-				colors[i] = new_color;
+			for (unsigned int i = 0; i < render_handles.size(); i++)
+				components.Color(render_handles[i], new_color);
 		}
 		//or only the selected one
-		else if (shape_index < colors.size())
+		else if (shape_index < render_handles.size())
 		{
-			colors[shape_index] = new_color;
+			components.Color(render_handles[shape_index], new_color);
 		}
 	}
 
-	const PxVec3* Actor::Color(PxU32 shape_indx)
+	PxVec3 Actor::Color(PxU32 shape_index)
 	{
-		if (shape_indx < colors.size())
-			return &colors[shape_indx];
+		if (shape_index < render_handles.size())
+			return GetRenderComponents().Color(render_handles[shape_index]);
 		else 
-			return 0;			
+			return default_color;
 	}
 
 	void Actor::Material(PxMaterial* new_material, PxU32 shape_index)
@@ -194,21 +259,13 @@ namespace PhysicsEngine
 		Name("");
 	}
 
-	DynamicActor::~DynamicActor()
-	{
-		for (unsigned int i = 0; i < colors.size(); i++)
-			delete (UserData*)GetShape(i)->userData;
-	}
-
 	void DynamicActor::CreateShape(const PxGeometry& geometry, PxReal density)
 	{
 		PxShape* shape = ((PxRigidDynamic*)actor)->createShape(geometry,*GetMaterial());
 		PxRigidBodyExt::updateMassAndInertia(*(PxRigidDynamic*)actor, density);
-		colors.push_back(default_color);
-		//pass the color pointers to the renderer
-		shape->userData = new UserData();
-		for (unsigned int i = 0; i < colors.size(); i++)
-			((UserData*)GetShape(i)->userData)->color = &colors[i];
+		//pass the render component to the renderer
+		render_handles.push_back(GetRenderComponents().Create(default_color));
+		shape->userData = RenderUserData(render_handles.back());
 	}
 
 	void DynamicActor::SetKinematic(bool value, PxU32 index)
@@ -222,35 +279,74 @@ namespace PhysicsEngine
 		Name("");
 	}
 
-	StaticActor::~StaticActor()
+	void StaticActor::CreateShape(const PxGeometry& geometry, PxReal density)
 	{
-		for (unsigned int i = 0; i < colors.size(); i++)
-			delete (UserData*)GetShape(i)->userData;
+		PxShape* shape = ((PxRigidStatic*)actor)->createShape(geometry,*GetMaterial());
+		//pass the render component to the renderer
+		render_handles.push_back(GetRenderComponents().Create(default_color));
+		shape->userData = RenderUserData(render_handles.back());
 	}
 
-	void StaticActor::CreateShape(const PxGeometry& geometry, PxReal density)
+	ClonedActor::ClonedActor(PxActor* source, PxActor* copy)
 	{
-		PxShape* shape = ((PxRigidStatic*)actor)->createShape(geometry,*GetMaterial());
-		colors.push_back(default_color);
-		//pass the color pointers to the renderer
-		shape->userData = new UserData();
-		for (unsigned int i = 0; i < colors.size(); i++)
-			((UserData*)GetShape(i)->userData)->color = &colors[i];
+		actor = copy;
+		Name(source->getName() ? source->getName() : "");
+
+		RenderComponents& components = GetRenderComponents();
+		if (source->isCloth())
+		{
+			RenderHandle handle = GetRenderHandle(source->userData);
+			const PxClothMeshDesc* source_desc = components.ClothMeshDesc(handle);
+
+			//only the quads are used for rendering, the points belong to the source
+			if (source_desc)
+			{
+				mesh_desc = *source_desc;
+				const PxU32* source_quads = (const PxU32*)mesh_desc.quads.data;
+				quads.assign(source_quads, source_quads + mesh_desc.quads.count*4);
+				mesh_desc.quads.data = quads.size() ? &quads.front() : 0;
+				mesh_desc.points.data = 0;
+				mesh_desc.invMasses.data = 0;
+			}
+			render_handles.push_back(components.Create(handle ? components.Color(handle) : default_color, 0, source_desc ? &mesh_desc : 0));
+			actor->userData = RenderUserData(render_handles.back());
+			return;
+		}
+
+		//PxCloneStatic and PxCloneDynamic keep the order of the shapes
+		PxRigidActor* source_actor = (PxRigidActor*)source;
+		std::vector<PxShape*> source_shapes(source_actor->getNbShapes());
+		if (source_shapes.size())
+			source_actor->getShapes(&source_shapes.front(), (PxU32)source_shapes.size());
+		std::vector<PxShape*> shapes = GetShapes();
+
+		//sized up front, the render components point into the palettes
+		palettes.resize(source_shapes.size());
+		for (PxU32 i = 0; i < source_shapes.size(); i++)
+		{
+			RenderHandle handle = GetRenderHandle(source_shapes[i]->userData);
+			//a palette has a colour for every material slot
+			const PxVec3* palette = components.Palette(handle);
+			if (palette)
+				palettes[i].assign(palette, palette + source_shapes[i]->getNbMaterials());
+			render_handles.push_back(components.Create(handle ? components.Color(handle) : default_color, palettes[i].size() ? &palettes[i].front() : 0));
+			shapes[i]->userData = RenderUserData(render_handles.back());
+		}
 	}
 
 	///Scene methods
-	void Scene::Init()
+	void Scene::CreateScene()
 	{
 		//scene
 		PxSceneDesc sceneDesc(GetPhysics()->getTolerancesScale());
 
-		if(!sceneDesc.cpuDispatcher)
-		{
-			PxDefaultCpuDispatcher* mCpuDispatcher = PxDefaultCpuDispatcherCreate(1);
-			sceneDesc.cpuDispatcher = mCpuDispatcher;
-		}
+		//all scenes share the worker pool
+		sceneDesc.cpuDispatcher = GetDispatcher();
 
 		sceneDesc.filterShader = filter_shader;
+
+		//report the actors moved by each step (see MovedActors)
+		sceneDesc.flags |= PxSceneFlag::eENABLE_ACTIVETRANSFORMS;
 		
 		//sceneDesc.flags |= PxSceneFlag::eENABLE_CCD;
 
@@ -258,6 +354,12 @@ namespace PhysicsEngine
 
 		if (!px_scene)
 			throw new Exception("PhysicsEngine::Scene::Init, Could not initialise the scene.");
+	}
+
+	void Scene::Init()
+	{
+		CreateScene();
+		revision++;
 
 		//default gravity
 		px_scene->setGravity(PxVec3(0.0f, -9.81f, 0.0f));
@@ -271,15 +373,42 @@ namespace PhysicsEngine
 		SelectNextActor();
 	}
 
+	Scene::~Scene()
+	{
+		ReleaseClones();
+
+		if (px_scene)
+			px_scene->release();
+	}
+
 	void Scene::Update(PxReal dt)
 	{
 		if (pause)
+		{
+			//nothing moves by itself (actors moved by commands are reported with ActorsMoved)
+			simulate_time = fetch_time = 0.f;
+			moved_actors.clear();
 			return;
+		}
 
 		CustomUpdate();
 
+		typedef std::chrono::high_resolution_clock Clock;
+		Clock::time_point start = Clock::now();
 		px_scene->simulate(dt);
+		Clock::time_point simulated = Clock::now();
 		px_scene->fetchResults(true);
+		Clock::time_point fetched = Clock::now();
+
+		simulate_time = std::chrono::duration<PxReal>(simulated - start).count();
+		fetch_time = std::chrono::duration<PxReal>(fetched - simulated).count();
+
+		//the active transforms are only valid until the next simulate call
+		PxU32 nb_transforms;
+		const PxActiveTransform* transforms = px_scene->getActiveTransforms(nb_transforms);
+		moved_actors.resize(nb_transforms);
+		for (PxU32 i = 0; i < nb_transforms; i++)
+			moved_actors[i] = transforms[i].actor;
 	}
 
 	void Scene::Add(Actor* actor)
@@ -287,6 +416,15 @@ namespace PhysicsEngine
 		px_scene->addActor(*actor->Get());
 	}
 
+	void Scene::Add(const std::vector<Actor*>& actors)
+	{
+		std::vector<PxActor*> px_actors(actors.size());
+		for (unsigned int i = 0; i < actors.size(); i++)
+			px_actors[i] = actors[i]->Get();
+		if (px_actors.size())
+			px_scene->addActors(&px_actors.front(), (PxU32)px_actors.size());
+	}
+
 	PxScene* Scene::Get() 
 	{ 
 		return px_scene; 
@@ -294,6 +432,7 @@ namespace PhysicsEngine
 
 	void Scene::Reset()
 	{
+		ReleaseClones();
 		px_scene->release();
 		Init();
 	}
@@ -340,12 +479,311 @@ namespace PhysicsEngine
 	}
 
 	std::vector<PxActor*> Scene::GetAllActors()
+	{
+		std::vector<PxActor*> actors;
+		GetAllActors(actors);
+		return actors;
+	}
+
+	void Scene::GetAllActors(std::vector<PxActor*>& actors)
 	{
 		physx::PxActorTypeSelectionFlags selection_flag = PxActorTypeSelectionFlag::eRIGID_DYNAMIC | PxActorTypeSelectionFlag::eRIGID_STATIC | 
 			PxActorTypeSelectionFlag::eCLOTH;
-		std::vector<PxActor*> actors(px_scene->getNbActors(selection_flag));
-		px_scene->getActors(selection_flag, (PxActor**)&actors.front(), (PxU32)actors.size());
-		return actors;
+		actors.resize(px_scene->getNbActors(selection_flag));
+		if (actors.size())
+			px_scene->getActors(selection_flag, &actors.front(), (PxU32)actors.size());
+	}
+
+	void Scene::GetStateActors()
+	{
+		PxActorTypeSelectionFlags selection_flag = PxActorTypeSelectionFlag::eRIGID_DYNAMIC | PxActorTypeSelectionFlag::eCLOTH;
+		state_actors.resize(px_scene->getNbActors(selection_flag));
+		if (state_actors.size())
+			px_scene->getActors(selection_flag, &state_actors.front(), (PxU32)state_actors.size());
+	}
+
+	void Scene::SaveState(SceneState& state)
+	{
+		GetStateActors();
+
+		state.bodies.clear();
+		state.cloth_poses.clear();
+		state.cloth_particles.clear();
+		state.particles.clear();
+		state.previous_particles.clear();
+
+		for (PxU32 i = 0; i < state_actors.size(); i++)
+		{
+			if (state_actors[i]->isCloth())
+			{
+				PxCloth* cloth = (PxCloth*)state_actors[i];
+				state.cloth_poses.push_back(cloth->getGlobalPose());
+				state.cloth_particles.push_back(cloth->getNbParticles());
+
+				PxClothParticleData* data = cloth->lockParticleData(PxDataAccessFlag::eREADABLE);
+				if (!data)
+					throw new Exception("PhysicsEngine::Scene::SaveState, Could not read the cloth particles.");
+				state.particles.insert(state.particles.end(), data->particles, data->particles + cloth->getNbParticles());
+				state.previous_particles.insert(state.previous_particles.end(), data->previousParticles, data->previousParticles + cloth->getNbParticles());
+				data->unlock();
+			}
+			else
+			{
+				PxRigidDynamic* actor = (PxRigidDynamic*)state_actors[i];
+				SceneState::BodyState body;
+				body.pose = actor->getGlobalPose();
+				body.linear_velocity = actor->getLinearVelocity();
+				body.angular_velocity = actor->getAngularVelocity();
+				body.wake_counter = actor->getWakeCounter();
+				body.sleeping = actor->isSleeping();
+				state.bodies.push_back(body);
+			}
+		}
+	}
+
+	void Scene::RestoreState(const SceneState& state)
+	{
+		GetStateActors();
+
+		if (state_actors.size() != state.bodies.size() + state.cloth_poses.size())
+			throw new Exception("PhysicsEngine::Scene::RestoreState, The state belongs to a different scene.");
+
+		//sleeping actors are moved without a report
+		revision++;
+
+		PxU32 body = 0, cloth_index = 0, particle = 0;
+		for (PxU32 i = 0; i < state_actors.size(); i++)
+		{
+			if (state_actors[i]->isCloth())
+			{
+				PxCloth* cloth = (PxCloth*)state_actors[i];
+				PxU32 nb_particles = state.cloth_particles[cloth_index];
+				if (nb_particles != cloth->getNbParticles())
+					throw new Exception("PhysicsEngine::Scene::RestoreState, The state belongs to a different scene.");
+
+				cloth->setGlobalPose(state.cloth_poses[cloth_index]);
+				cloth->setParticles(&state.particles[particle], &state.previous_particles[particle]);
+				cloth_index++;
+				particle += nb_particles;
+			}
+			else
+			{
+				PxRigidDynamic* actor = (PxRigidDynamic*)state_actors[i];
+				const SceneState::BodyState& body_state = state.bodies[body++];
+				actor->setGlobalPose(body_state.pose);
+
+				//kinematic actors have no velocities or sleep state of their own
+				if (actor->getRigidDynamicFlags() & PxRigidDynamicFlag::eKINEMATIC)
+					continue;
+
+				actor->setLinearVelocity(body_state.linear_velocity, false);
+				actor->setAngularVelocity(body_state.angular_velocity, false);
+				if (body_state.sleeping)
+					actor->putToSleep();
+				else
+					actor->setWakeCounter(body_state.wake_counter);
+			}
+		}
+	}
+
+	Scene* Scene::Clone()
+	{
+		Scene* copy = new Scene(filter_shader);
+		try
+		{
+			CloneInto(*copy);
+		}
+		catch (Exception*)
+		{
+			delete copy;
+			throw;
+		}
+		return copy;
+	}
+
+	void Scene::CloneInto(Scene& copy)
+	{
+		copy.CreateScene();
+		copy.px_scene->setGravity(px_scene->getGravity());
+
+		//actors in the order of the source scene
+		std::vector<PxActor*> actors = GetAllActors();
+		for (PxU32 i = 0; i < actors.size(); i++)
+		{
+			PxActor* source = actors[i];
+			PxActor* px_copy = 0;
+			if (source->isCloth())
+			{
+				//the fabric is shared, the particles are copied
+				PxCloth* cloth = (PxCloth*)source;
+				PxClothParticleData* data = cloth->lockParticleData(PxDataAccessFlag::eREADABLE);
+				if (!data)
+					throw new Exception("PhysicsEngine::Scene::Clone, Could not read the cloth particles.");
+				PxCloth* cloth_copy = GetPhysics()->createCloth(cloth->getGlobalPose(), *cloth->getFabric(), data->particles, cloth->getClothFlags());
+				if (cloth_copy)
+				{
+					cloth_copy->setParticles(data->particles, data->previousParticles);
+					cloth_copy->setExternalAcceleration(cloth->getExternalAcceleration());
+				}
+				data->unlock();
+				px_copy = cloth_copy;
+			}
+			else if (source->isRigidDynamic())
+			{
+				//shapes, mass properties, damping and flags (the velocities are copied below)
+				PxRigidDynamic* body = (PxRigidDynamic*)source;
+				px_copy = PxCloneDynamic(*GetPhysics(), body->getGlobalPose(), *body);
+			}
+			else
+			{
+				PxRigidActor* rigid = (PxRigidActor*)source;
+				px_copy = PxCloneStatic(*GetPhysics(), rigid->getGlobalPose(), *rigid);
+			}
+
+			if (!px_copy)
+				throw new Exception("PhysicsEngine::Scene::Clone, Could not copy an actor.");
+
+			copy.clone_sources.push_back(source);
+			copy.cloned_actors.push_back(new ClonedActor(source, px_copy));
+			copy.px_scene->addActor(*px_copy);
+
+			//the sleep state can only be set once the actor is in the scene
+			if (source->isCloth())
+			{
+				if (((PxCloth*)source)->isSleeping())
+					((PxCloth*)px_copy)->putToSleep();
+			}
+			else if (source->isRigidDynamic())
+			{
+				PxRigidDynamic* body = (PxRigidDynamic*)source;
+				PxRigidDynamic* body_copy = (PxRigidDynamic*)px_copy;
+
+				//kinematic actors have no velocities or sleep state of their own
+				if (body->getRigidDynamicFlags() & PxRigidDynamicFlag::eKINEMATIC)
+					continue;
+
+				body_copy->setLinearVelocity(body->getLinearVelocity(), false);
+				body_copy->setAngularVelocity(body->getAngularVelocity(), false);
+				if (body->isSleeping())
+					body_copy->putToSleep();
+				else
+					body_copy->setWakeCounter(body->getWakeCounter());
+			}
+		}
+
+		//joints between the copied actors (the course and the club only use revolute joints)
+		std::vector<PxConstraint*> constraints(px_scene->getNbConstraints());
+		if (constraints.size())
+			px_scene->getConstraints(&constraints.front(), (PxU32)constraints.size());
+		for (PxU32 i = 0; i < constraints.size(); i++)
+		{
+			PxU32 type;
+			PxJoint* joint = (PxJoint*)constraints[i]->getExternalReference(type);
+			if (type != PxConstraintExtIDs::eJOINT)
+				continue;
+
+			PxRevoluteJoint* revolute = joint->is<PxRevoluteJoint>();
+			if (!revolute)
+				throw new Exception("PhysicsEngine::Scene::Clone, Only revolute joints can be copied.");
+
+			//0 stands for the world frame
+			PxRigidActor *actor0, *actor1;
+			revolute->getActors(actor0, actor1);
+			Actor* copy0 = actor0 ? copy.Cloned(actor0) : 0;
+			Actor* copy1 = actor1 ? copy.Cloned(actor1) : 0;
+			if ((actor0 && !copy0) || (actor1 && !copy1))
+				continue;
+
+			PxRevoluteJoint* joint_copy = PxRevoluteJointCreate(*GetPhysics(),
+				copy0 ? (PxRigidActor*)copy0->Get() : 0, revolute->getLocalPose(PxJointActorIndex::eACTOR0),
+				copy1 ? (PxRigidActor*)copy1->Get() : 0, revolute->getLocalPose(PxJointActorIndex::eACTOR1));
+			if (!joint_copy)
+				throw new Exception("PhysicsEngine::Scene::Clone, Could not copy a joint.");
+
+			joint_copy->setLimit(revolute->getLimit());
+			joint_copy->setDriveVelocity(revolute->getDriveVelocity());
+			joint_copy->setDriveForceLimit(revolute->getDriveForceLimit());
+			joint_copy->setDriveGearRatio(revolute->getDriveGearRatio());
+			joint_copy->setRevoluteJointFlags(revolute->getRevoluteJointFlags());
+			joint_copy->setProjectionLinearTolerance(revolute->getProjectionLinearTolerance());
+			joint_copy->setProjectionAngularTolerance(revolute->getProjectionAngularTolerance());
+			joint_copy->setConstraintFlags(revolute->getConstraintFlags());
+			PxReal force, torque;
+			revolute->getBreakForce(force, torque);
+			joint_copy->setBreakForce(force, torque);
+
+			copy.clone_joint_sources.push_back(joint);
+			copy.cloned_joints.push_back(new ClonedJoint(joint_copy));
+		}
+
+		//selection and its highlight (the copied colours are already highlighted)
+		copy.pause = pause;
+		copy.selected_actor = 0;
+		if (selected_actor)
+		{
+			Actor* selected = copy.Cloned(selected_actor);
+			if (selected)
+			{
+				copy.selected_actor = (PxRigidDynamic*)selected->Get();
+				copy.sactor_color_orig = sactor_color_orig;
+			}
+		}
+	}
+
+	Actor* Scene::Cloned(PxActor* source)
+	{
+		for (PxU32 i = 0; i < clone_sources.size(); i++)
+			if (clone_sources[i] == source)
+				return cloned_actors[i];
+		return 0;
+	}
+
+	Actor* Scene::Adopt(PxActor* source)
+	{
+		for (PxU32 i = 0; i < clone_sources.size(); i++)
+			if (clone_sources[i] == source)
+			{
+				Actor* actor = cloned_actors[i];
+				cloned_actors[i] = 0;
+				return actor;
+			}
+		return 0;
+	}
+
+	Joint* Scene::Adopt(PxJoint* source)
+	{
+		for (PxU32 i = 0; i < clone_joint_sources.size(); i++)
+			if (clone_joint_sources[i] == source)
+			{
+				Joint* joint = cloned_joints[i];
+				cloned_joints[i] = 0;
+				return joint;
+			}
+		return 0;
+	}
+
+	void Scene::ReleaseClones()
+	{
+		//joints before the actors they connect
+		for (PxU32 i = 0; i < cloned_joints.size(); i++)
+			if (cloned_joints[i])
+			{
+				cloned_joints[i]->Get()->release();
+				delete cloned_joints[i];
+			}
+
+		for (PxU32 i = 0; i < cloned_actors.size(); i++)
+			if (cloned_actors[i])
+			{
+				PxActor* px_actor = cloned_actors[i]->Get();
+				delete cloned_actors[i];
+				px_actor->release();
+			}
+
+		clone_sources.clear();
+		cloned_actors.clear();
+		clone_joint_sources.clear();
+		cloned_joints.clear();
 	}
 
 	void Scene::HighlightOn(PxRigidDynamic* actor)
@@ -356,11 +794,13 @@ namespace PhysicsEngine
 
 		sactor_color_orig.clear();
 
+		RenderComponents& components = GetRenderComponents();
 		for (unsigned int i = 0; i < shapes.size(); i++)
 		{
-			PxVec3* color = ((UserData*)shapes[i]->userData)->color;
-			sactor_color_orig.push_back(*color);
-			*color += PxVec3(.2f,.2f,.2f);
+			RenderHandle handle = GetRenderHandle(shapes[i]->userData);
+			PxVec3 color = components.Color(handle);
+			sactor_color_orig.push_back(color);
+			components.Color(handle, color + PxVec3(.2f,.2f,.2f));
 		}
 	}
 
@@ -370,7 +810,8 @@ namespace PhysicsEngine
 		std::vector<PxShape*> shapes(actor->getNbShapes());
 		actor->getShapes((PxShape**)&shapes.front(), (PxU32)shapes.size());
 
+		RenderComponents& components = GetRenderComponents();
 		for (unsigned int i = 0; i < shapes.size(); i++)
-			*((UserData*)shapes[i]->userData)->color = sactor_color_orig[i];
+			components.Color(GetRenderHandle(shapes[i]->userData), sactor_color_orig[i]);
 	}
 }
@@ -12,7 +12,8 @@ namespace PhysicsEngine
 	using namespace std;
 	
 	///Initialise PhysX framework
-	void PxInit();
+	///All scenes share one worker pool of nb_threads threads.
+	void PxInit(PxU32 nb_threads=1);
 
 	///Release PhysX resources
 	void PxRelease();
@@ -23,12 +24,25 @@ namespace PhysicsEngine
 	///Get the cooking object
 	PxCooking* GetCooking();
 
+	///Get the worker pool shared by all scenes
+	PxCpuDispatcher* GetDispatcher();
+
 	///Get the specified material
 	PxMaterial* GetMaterial(PxU32 index=0);
 
 	///Create a new material
 	PxMaterial* CreateMaterial(PxReal sf=.0f, PxReal df=.0f, PxReal cr=.0f);
 
+	///Get a shared material with the given properties (created on first use)
+	///Scenes built from the same course share their materials instead of creating copies.
+	///Shared materials must not be modified.
+	PxMaterial* SharedMaterial(PxReal sf, PxReal df, PxReal cr);
+
+	///Create a height field from a grid of heights stored row by row
+	///Rows run along the local x axis and columns along the local z axis.
+	///The heights are quantized to 16 bits, height_scale returns the scale for PxHeightFieldGeometry.
+	PxHeightField* CreateHeightField(const PxReal* heights, PxU32 rows, PxU32 columns, PxReal& height_scale);
+
 	static const PxVec3 default_color(.8f,.8f,.8f);
 
 	///Abstract Actor class
@@ -37,7 +51,8 @@ namespace PhysicsEngine
 	{
 	protected:
 		PxActor* actor;
-		std::vector<PxVec3> colors;
+		//render components of the shapes (or of the cloth), see RenderComponents
+		std::vector<RenderHandle> render_handles;
 		std::string name;
 
 	public:
@@ -47,11 +62,15 @@ namespace PhysicsEngine
 		{
 		}
 
+		///Release the render components
+		virtual ~Actor();
+
 		PxActor* Get();
 
 		void Color(PxVec3 new_color, PxU32 shape_index=-1);
 
-		const PxVec3* Color(PxU32 shape_indx=0);
+		///Colour of a shape (the default colour for invalid indices)
+		PxVec3 Color(PxU32 shape_index=0);
 
 		void Actor::Name(const string& name);
 
@@ -75,8 +94,6 @@ namespace PhysicsEngine
 	public:
 		DynamicActor(const PxTransform& pose);
 
-		~DynamicActor();
-
 		void CreateShape(const PxGeometry& geometry, PxReal density);
 
 		void SetKinematic(bool value, PxU32 index=-1);
@@ -87,11 +104,42 @@ namespace PhysicsEngine
 	public:
 		StaticActor(const PxTransform& pose);
 
-		~StaticActor();
-
 		void CreateShape(const PxGeometry& geometry, PxReal density=0.f);
 	};
 
+	///Copy of an actor of another scene (see Scene::Clone)
+	///The copy has its own render components, palettes and cloth quads, so the scenes can be changed and released independently.
+	class ClonedActor : public Actor
+	{
+		std::vector<std::vector<PxVec3> > palettes;
+		std::vector<PxU32> quads;
+		PxClothMeshDesc mesh_desc;
+
+	public:
+		///Wrap the PhysX copy of a source actor and copy the render data of the source
+		ClonedActor(PxActor* source, PxActor* copy);
+	};
+
+	class Joint;
+
+	///Dynamic state of a scene: the rigid dynamic actors and the cloths
+	///The state is stored in actor order, so it can be restored into any scene built the same way.
+	struct SceneState
+	{
+		struct BodyState
+		{
+			PxTransform pose;
+			PxVec3 linear_velocity, angular_velocity;
+			PxReal wake_counter;
+			bool sleeping;
+		};
+
+		std::vector<BodyState> bodies;
+		std::vector<PxTransform> cloth_poses;
+		std::vector<PxU32> cloth_particles;
+		std::vector<PxClothParticle> particles, previous_particles;
+	};
+
 	///Generic scene class
 	class Scene
 	{
@@ -106,13 +154,49 @@ namespace PhysicsEngine
 		std::vector<PxVec3> sactor_color_orig;
 		//custom filter shader
 		PxSimulationFilterShader filter_shader;
+		//duration of the last simulate and fetchResults calls (in seconds)
+		PxReal simulate_time, fetch_time;
+		//actor buffer of SaveState and RestoreState
+		std::vector<PxActor*> state_actors;
+		//actors moved by the last step and the number of times actors were moved outside of a step
+		std::vector<PxActor*> moved_actors;
+		PxU32 revision;
+		//actors and joints created by Clone and their sources (adopted entries are 0)
+		std::vector<PxActor*> clone_sources;
+		std::vector<Actor*> cloned_actors;
+		std::vector<PxJoint*> clone_joint_sources;
+		std::vector<Joint*> cloned_joints;
+
+		void CreateScene();
+
+		void GetStateActors();
+
+		///Copy the actors, joints and dynamic state of this scene into an empty scene (see Clone)
+		///Derived classes call this from their Clone and then copy their own members.
+		void CloneInto(Scene& copy);
+
+		///The copy of a source actor made by CloneInto (0 if it was not copied or has been adopted)
+		Actor* Cloned(PxActor* source);
+
+		///Take over the copy of a source actor: the caller deletes the wrapper and releases the actor
+		Actor* Adopt(PxActor* source);
+
+		///Take over the copy of a source joint: the caller deletes the wrapper and releases the joint
+		Joint* Adopt(PxJoint* source);
+
+		///Release the copies that have not been adopted
+		void ReleaseClones();
 
 		void HighlightOn(PxRigidDynamic* actor);
 
 		void HighlightOff(PxRigidDynamic* actor);
 
 	public:
-		Scene(PxSimulationFilterShader custom_filter_shader=PxDefaultSimulationFilterShader) : filter_shader(custom_filter_shader) {}
+		Scene(PxSimulationFilterShader custom_filter_shader=PxDefaultSimulationFilterShader) : px_scene(0), filter_shader(custom_filter_shader), simulate_time(0.f), fetch_time(0.f),
+			revision(0) {}
+
+		///Release the PhysX scene (the actors have to be released by the derived class, copies made by Clone are released here)
+		virtual ~Scene();
 
 		///Init the scene
 		void Init();
@@ -126,9 +210,28 @@ namespace PhysicsEngine
 		///User defined update step
 		virtual void CustomUpdate() {}
 
+		///Duration of the last simulate call in seconds
+		PxReal SimulateTime() { return simulate_time; }
+
+		///Duration of the last fetchResults call in seconds
+		PxReal FetchTime() { return fetch_time; }
+
+		///Actors moved by the last step (the active transforms of PhysX)
+		const std::vector<PxActor*>& MovedActors() { return moved_actors; }
+
+		///Changes whenever actors may have been moved without being reported by MovedActors
+		///(Init, Reset, RestoreState and ActorsMoved), caches of the poses have to be rebuilt then.
+		PxU32 Revision() { return revision; }
+
+		///Report that actors were moved outside of a simulation step (by setting their poses directly)
+		void ActorsMoved() { revision++; }
+
 		///Add actors
 		void Add(Actor* actor);
 
+		///Add multiple actors in a single call
+		void Add(const std::vector<Actor*>& actors);
+
 		///Get the PxScene object
 		PxScene* Get();
 
@@ -149,6 +252,23 @@ namespace PhysicsEngine
 
 		///a list with all actors
 		std::vector<PxActor*> GetAllActors();
+
+		///Fill a list with all actors (keeps the capacity of the list, so refilling it does not allocate)
+		void GetAllActors(std::vector<PxActor*>& actors);
+
+		///Save the dynamic state (poses, velocities, sleep state and cloth particles)
+		///Does not allocate once the state has been filled before.
+		void SaveState(SceneState& state);
+
+		///Restore a state saved from this scene or from a scene built the same way
+		void RestoreState(const SceneState& state);
+
+		///Create an independent copy of the scene for what-if simulations
+		///Actors, revolute joints and the dynamic state (poses, velocities, sleep state and cloth particles) are copied directly,
+		///geometry, materials and cloth fabrics are shared, so a copy is cheap enough to make several times per frame.
+		///The copy keeps the actor order, so states saved from one scene can be restored into the other.
+		///Like Init, do not call it while another scene is created or released on another thread.
+		virtual Scene* Clone();
 	};
 
 	///Generic Joint class
@@ -160,9 +280,18 @@ namespace PhysicsEngine
 	public:
 		Joint() : joint(0) {}
 
+		virtual ~Joint() {}
+
 		PxJoint* Get() { return joint; }
 	};
 
+	///Copy of a joint of another scene (see Scene::Clone)
+	class ClonedJoint : public Joint
+	{
+	public:
+		ClonedJoint(PxJoint* copy) { joint = copy; }
+	};
+
 
 }
 
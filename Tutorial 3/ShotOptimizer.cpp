@@ -0,0 +1,234 @@
+#include "ShotOptimizer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
+namespace PhysicsEngine
+{
+	//a ball this far below the hole outside of it has left the course
+	static const PxReal LOST_DEPTH = 1.f;
+	//time after the swing before a shot can end at rest (the club may still be on its way to the ball)
+	static const PxReal MIN_SETTLE_TIME = .5f;
+	//a ball that moved this far since the shot started has been hit
+	static const PxReal MOVED_DISTANCE = .01f;
+
+	//lower is better: holed shots first (the quickest), then the closest to the hole, lost balls last
+	static PxReal Score(const ShotResult& result)
+	{
+		if (result.holed)
+			return result.time;
+		if (result.lost)
+			return 1e6f + result.distance;
+		return 1e3f + result.distance;
+	}
+
+	static bool Better(const ShotResult& a, const ShotResult& b)
+	{
+		return Score(a) < Score(b);
+	}
+
+	ShotOptimizer::ShotOptimizer(const string& course_file, PxU32 nb_threads)
+		: evaluated(0), evaluation_time(0.f)
+	{
+		if (!GetPhysics())
+			throw new Exception("ShotOptimizer::ShotOptimizer, PhysX has to be initialised first.");
+
+		if (!nb_threads)
+			nb_threads = PxMax(std::thread::hardware_concurrency(), 1u);
+
+		//the course is loaded once, the other threads simulate copies of the first scene
+		MyScene* scene = new MyScene(course_file);
+		scenes.push_back(scene);
+		scene->Init();
+		PrepareShotScene(*scene);
+		for (PxU32 i = 1; i < nb_threads; i++)
+			scenes.push_back(scene->Clone());
+	}
+
+	ShotOptimizer::~ShotOptimizer()
+	{
+		for (PxU32 i = 0; i < scenes.size(); i++)
+			delete scenes[i];
+	}
+
+	void ShotOptimizer::StartState(SceneState& state)
+	{
+		scenes[0]->SaveState(state);
+	}
+
+	void PrepareShotScene(MyScene& scene)
+	{
+		scene.Announce(false);
+
+		//the flag is only for show
+		std::vector<PxActor*> actors = scene.GetAllActors();
+		for (PxU32 i = 0; i < actors.size(); i++)
+			if (actors[i]->isCloth())
+				scene.Get()->removeActor(*actors[i]);
+	}
+
+	void PlayShot(MyScene& scene, const Shot& shot, PxReal step, PxReal max_time, ShotResult& result)
+	{
+		scene.Won(false);
+		scene.placeClub();
+		if (shot.offset != 0.f)
+			scene.translateClub(PxVec3(shot.offset, 0.f, 0.f));
+
+		PxRigidDynamic* ball = scene.Ball();
+		PxRigidDynamic* club = scene.ClubHead();
+		PxVec3 hole = scene.HoleCenter();
+		PxU32 max_steps = (PxU32)(max_time / step);
+		PxU32 settle_steps = shot.swing_steps + (PxU32)(MIN_SETTLE_TIME / step);
+
+		result.shot = shot;
+		result.holed = result.lost = result.rested = false;
+
+		PxU32 i = 0;
+		PxVec3 start = ball->getGlobalPose().p;
+		PxVec3 position = start;
+		//a restored ball sleeps until the club reaches it, so it only counts as at rest once it has been hit
+		bool hit = false;
+		while (i < max_steps)
+		{
+			if (i < shot.swing_steps)
+				scene.swingClub(shot.strength);
+			scene.Update(step);
+			i++;
+
+			//early termination: holed, off the course or at rest after the swing
+			position = ball->getGlobalPose().p;
+			if (scene.InHole(position))
+			{
+				result.holed = true;
+				break;
+			}
+			if (position.y < hole.y - LOST_DEPTH)
+			{
+				result.lost = true;
+				break;
+			}
+
+			if (!ball->isSleeping() || ((position - start).magnitudeSquared() > MOVED_DISTANCE*MOVED_DISTANCE))
+				hit = true;
+			//at rest: the club has stopped and the ball was hit and stopped too (or was missed)
+			if ((i >= settle_steps) && club->isSleeping() && (!hit || ball->isSleeping()))
+			{
+				result.rested = true;
+				break;
+			}
+		}
+
+		result.rest_position = position;
+		result.time = i * step;
+		result.distance = result.holed ? 0.f : (PxVec3(position.x, 0.f, position.z) - PxVec3(hole.x, 0.f, hole.z)).magnitude();
+	}
+
+	void ShotOptimizer::Evaluate(const SceneState& start, const std::vector<Shot>& shots, PxReal step, PxReal max_time, std::vector<ShotResult>& results)
+	{
+		typedef std::chrono::high_resolution_clock Clock;
+		Clock::time_point started = Clock::now();
+
+		results.resize(shots.size());
+
+		//every thread takes the next candidate until all are done
+		std::atomic<PxU32> next(0);
+		std::vector<std::thread> threads;
+		for (PxU32 t = 0; t < scenes.size(); t++)
+		{
+			threads.push_back(std::thread([&, t]()
+			{
+				for (PxU32 i = next++; i < shots.size(); i = next++)
+				{
+					scenes[t]->RestoreState(start);
+					PlayShot(*scenes[t], shots[i], step, max_time, results[i]);
+				}
+			}));
+		}
+		for (PxU32 t = 0; t < threads.size(); t++)
+			threads[t].join();
+
+		evaluated += (PxU32)shots.size();
+		evaluation_time += std::chrono::duration<PxReal>(Clock::now() - started).count();
+	}
+
+	ShotResult ShotOptimizer::Search(const SceneState& start, const ShotSearch& search)
+	{
+		std::mt19937 random(search.seed);
+		std::vector<Shot> shots(search.candidates);
+		std::vector<ShotResult> results, elites;
+
+		//the spread of the refinement halves every round
+		PxReal offset_range = search.max_offset - search.min_offset;
+		PxReal strength_range = search.max_strength - search.min_strength;
+		PxReal swing_range = (PxReal)(search.max_swing_steps - search.min_swing_steps);
+
+		for (PxU32 round = 0; round < search.rounds; round++)
+		{
+			for (PxU32 i = 0; i < shots.size(); i++)
+			{
+				Shot& shot = shots[i];
+				if (elites.empty())
+				{
+					shot.offset = std::uniform_real_distribution<PxReal>(search.min_offset, search.max_offset)(random);
+					shot.strength = std::uniform_real_distribution<PxReal>(search.min_strength, search.max_strength)(random);
+					shot.swing_steps = std::uniform_int_distribution<PxU32>(search.min_swing_steps, search.max_swing_steps)(random);
+				}
+				else
+				{
+					const Shot& elite = elites[i % elites.size()].shot;
+					PxReal spread = .25f / (1 << round);
+					std::normal_distribution<PxReal> noise(0.f, spread);
+					shot.offset = PxClamp(elite.offset + noise(random)*offset_range, search.min_offset, search.max_offset);
+					shot.strength = PxClamp(elite.strength + noise(random)*strength_range, search.min_strength, search.max_strength);
+					shot.swing_steps = (PxU32)PxClamp((PxReal)elite.swing_steps + noise(random)*swing_range + .5f,
+						(PxReal)search.min_swing_steps, (PxReal)search.max_swing_steps);
+				}
+			}
+
+			Evaluate(start, shots, search.step, search.max_time, results);
+
+			//keep the best tenth (and the best so far) for the next round
+			results.insert(results.end(), elites.begin(), elites.end());
+			PxU32 nb_elites = PxMax((PxU32)(shots.size() / 10), 1u);
+			std::partial_sort(results.begin(), results.begin() + PxMin(nb_elites, (PxU32)results.size()), results.end(), Better);
+			elites.assign(results.begin(), results.begin() + PxMin(nb_elites, (PxU32)results.size()));
+
+			if (elites[0].holed)
+				break;
+		}
+
+		return elites[0];
+	}
+
+	std::vector<ShotResult> ShotOptimizer::Play(const ShotSearch& search)
+	{
+		std::vector<ShotResult> strokes;
+		SceneState start;
+		StartState(start);
+
+		for (PxU32 stroke = 0; stroke < search.max_strokes; stroke++)
+		{
+			ShotSearch stroke_search = search;
+			stroke_search.seed = search.seed + stroke;
+			ShotResult best = Search(start, stroke_search);
+			strokes.push_back(best);
+
+			if (best.holed)
+				break;
+
+			//a lost ball is played again from the same place
+			if (!best.lost)
+			{
+				//replay the shot to continue from where the ball came to rest
+				ShotResult replay;
+				scenes[0]->RestoreState(start);
+				PlayShot(*scenes[0], best.shot, search.step, search.max_time, replay);
+				scenes[0]->SaveState(start);
+			}
+		}
+
+		return strokes;
+	}
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "MyPhysicsEngine.h"
+#include <vector>
+
+namespace PhysicsEngine
+{
+	///A single stroke: sideways club offset (translateClub), swing force (swingClub) and the number of steps the force is held
+	struct Shot
+	{
+		PxReal offset;
+		PxReal strength;
+		PxU32 swing_steps;
+	};
+
+	///Outcome of a simulated shot
+	struct ShotResult
+	{
+		Shot shot;
+		bool holed;
+		//the ball left the course
+		bool lost;
+		//the ball came to rest (false when the shot ran out of time)
+		bool rested;
+		PxVec3 rest_position;
+		//simulated time until the ball came to rest, was holed or lost, or max_time (in seconds)
+		PxReal time;
+		//distance of the final position to the hole (0 when holed)
+		PxReal distance;
+	};
+
+	///Settings of a shot search
+	struct ShotSearch
+	{
+		//ranges of the shot parameters
+		PxReal min_offset, max_offset;
+		PxReal min_strength, max_strength;
+		PxU32 min_swing_steps, max_swing_steps;
+		//candidates per round: the first round samples the ranges, the others refine the best candidates
+		PxU32 candidates, rounds;
+		PxU32 max_strokes;
+		//simulation step and the longest simulated shot (in seconds)
+		PxReal step, max_time;
+		PxU32 seed;
+
+		ShotSearch() : min_offset(-1.f), max_offset(1.f), min_strength(5.f), max_strength(60.f), min_swing_steps(1), max_swing_steps(60),
+			candidates(512), rounds(4), max_strokes(5), step(1.f/60.f), max_time(15.f), seed(1) {}
+	};
+
+	///Set up a scene for simulating shots without a window (no win message, no cloths: they do not affect the ball)
+	void PrepareShotScene(MyScene& scene);
+
+	///Play a shot from the current state of a scene
+	///The club is placed behind the ball, the shot ends as soon as the ball is holed or leaves the course, or when the ball
+	///(once hit) and the club are asleep after the swing and a short settle time.
+	void PlayShot(MyScene& scene, const Shot& shot, PxReal step, PxReal max_time, ShotResult& result);
+
+	///Monte Carlo search for the shots of a hole
+	///
+	///Candidate shots are simulated without a window on one scene per thread (copies of the first scene). Each candidate starts from a saved scene state.
+	class ShotOptimizer
+	{
+		std::vector<MyScene*> scenes;
+		PxU32 evaluated;
+		PxReal evaluation_time;
+
+	public:
+		///Create the search scenes for a course (all cores when nb_threads is 0, PxInit has to be called first)
+		ShotOptimizer(const string& course_file, PxU32 nb_threads=0);
+
+		~ShotOptimizer();
+
+		///State of a search scene before the first stroke
+		void StartState(SceneState& state);
+
+		///Simulate candidate shots from a start state in parallel (the results are in the order of the shots)
+		void Evaluate(const SceneState& start, const std::vector<Shot>& shots, PxReal step, PxReal max_time, std::vector<ShotResult>& results);
+
+		///Find the best shot from a start state: holed in the shortest time, or closest to the hole
+		ShotResult Search(const SceneState& start, const ShotSearch& search);
+
+		///Play the hole stroke by stroke, returns the strokes (the last one is holed if the hole was finished)
+		std::vector<ShotResult> Play(const ShotSearch& search);
+
+		///Number of candidates simulated so far
+		PxU32 Evaluated() { return evaluated; }
+
+		///Wall clock time spent simulating candidates (in seconds)
+		PxReal EvaluationTime() { return evaluation_time; }
+	};
+}
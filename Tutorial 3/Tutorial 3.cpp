@@ -1,21 +1,273 @@
 #include <iostream>
+#include <string>
+#include <cstdlib>
+#include <thread>
+#include <chrono>
+#include <algorithm>
 #include "VisualDebugger.h"
+#include "MatchHost.h"
+#include "ShotOptimizer.h"
+#include "ParameterSweep.h"
 
 using namespace std;
 
-int main()
+int main(int argc, char* argv[])
 {
+	//compile a course source into the binary course format: --compile <source.course> <binary>
+	if ((argc == 4) && (string(argv[1]) == "--compile"))
+	{
+		try
+		{
+			PhysicsEngine::CompileCourse(string(argv[2]), string(argv[3]));
+		}
+		catch (Exception* exc)
+		{
+			cerr << exc->what() << endl;
+			delete exc;
+			return 1;
+		}
+		return 0;
+	}
+
+	//play a specific course: --course <file>
+	//render without a window: --headless <frames> <image.ppm> [--size <width> <height>]
+	//record all frames: --capture <prefix> [--raw] [--fps <rate>]
+	//frame pacing of the window: --max-fps <rate> (0 = unlimited) --no-vsync
+	//fixed simulation rate: --physics-rate <steps per second>
+	//show the scene as a remote spectator receives it: --spectate <bytes per second>
+	//host independent matches without a window: --host <matches> <seconds> [--threads <count>]
+	//sweep physics parameters for a scripted shot: --sweep <file.csv> <offset> <strength> <swing steps> [--param <name> <first> <last> <count>]...
+	//let the bot play the course (exits with 1 if it can not hole it): --autoplay <max strokes> [--threads <count>]
+	//time the course with and without merged static geometry: --bench <steps> [--size <width> <height>]
+	const char* course_file = 0;
+	const char* image_file = 0;
+	const char* capture_prefix = 0;
+	bool capture_raw = false;
+	float capture_fps = 60.f;
+	float max_fps = 60.f;
+	float physics_rate = 60.f;
+	int spectate_bandwidth = 0;
+	bool vsync = true;
+	int frames = 0, width = 800, height = 800;
+	int host_matches = 0, host_threads = 0;
+	int autoplay_strokes = 0;
+	int bench_steps = 0;
+	const char* sweep_file = 0;
+	PhysicsEngine::Shot sweep_shot;
+	std::vector<PhysicsEngine::SweepRange> sweep_ranges;
+	float host_seconds = 0.f;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg(argv[i]);
+		if ((arg == "--course") && (i + 1 < argc))
+			course_file = argv[++i];
+		else if ((arg == "--headless") && (i + 2 < argc))
+		{
+			frames = atoi(argv[++i]);
+			image_file = argv[++i];
+		}
+		else if ((arg == "--capture") && (i + 1 < argc))
+			capture_prefix = argv[++i];
+		else if (arg == "--raw")
+			capture_raw = true;
+		else if ((arg == "--fps") && (i + 1 < argc))
+			capture_fps = (float)atof(argv[++i]);
+		else if ((arg == "--max-fps") && (i + 1 < argc))
+			max_fps = (float)atof(argv[++i]);
+		else if ((arg == "--physics-rate") && (i + 1 < argc))
+			physics_rate = (float)atof(argv[++i]);
+		else if (arg == "--no-vsync")
+			vsync = false;
+		else if ((arg == "--host") && (i + 2 < argc))
+		{
+			host_matches = atoi(argv[++i]);
+			host_seconds = (float)atof(argv[++i]);
+		}
+		else if ((arg == "--spectate") && (i + 1 < argc))
+			spectate_bandwidth = atoi(argv[++i]);
+		else if ((arg == "--sweep") && (i + 4 < argc))
+		{
+			sweep_file = argv[++i];
+			sweep_shot.offset = (float)atof(argv[++i]);
+			sweep_shot.strength = (float)atof(argv[++i]);
+			sweep_shot.swing_steps = atoi(argv[++i]);
+		}
+		else if ((arg == "--param") && (i + 4 < argc))
+		{
+			PhysicsEngine::SweepRange range;
+			range.name = argv[++i];
+			range.first = (float)atof(argv[++i]);
+			range.last = (float)atof(argv[++i]);
+			range.count = atoi(argv[++i]);
+			sweep_ranges.push_back(range);
+		}
+		else if ((arg == "--autoplay") && (i + 1 < argc))
+			autoplay_strokes = atoi(argv[++i]);
+		else if ((arg == "--bench") && (i + 1 < argc))
+			bench_steps = atoi(argv[++i]);
+		else if ((arg == "--threads") && (i + 1 < argc))
+			host_threads = atoi(argv[++i]);
+		else if ((arg == "--size") && (i + 2 < argc))
+		{
+			width = atoi(argv[++i]);
+			height = atoi(argv[++i]);
+		}
+	}
+
+	if (sweep_file)
+	{
+		if (host_threads <= 0)
+			host_threads = max((int)std::thread::hardware_concurrency(), 1);
+		try
+		{
+			PhysicsEngine::PxInit(host_threads);
+			{
+				PhysicsEngine::ParameterSweep sweep(course_file ? course_file : "Courses\\Hole1.course");
+				for (unsigned int i = 0; i < sweep_ranges.size(); i++)
+					sweep.Add(sweep_ranges[i]);
+
+				std::vector<PhysicsEngine::SweepResult> results;
+				sweep.Run(sweep_shot, results, host_threads, 1.f/physics_rate);
+				sweep.WriteCSV(sweep_file, results);
+				cout << results.size() << " combinations written to " << sweep_file << endl;
+			}
+			PhysicsEngine::PxRelease();
+		}
+		catch (Exception* exc)
+		{
+			cerr << exc->what() << endl;
+			delete exc;
+			return 1;
+		}
+		return 0;
+	}
+
+	if (autoplay_strokes > 0)
+	{
+		if (host_threads <= 0)
+			host_threads = max((int)std::thread::hardware_concurrency(), 1);
+		bool holed = false;
+		try
+		{
+			PhysicsEngine::PxInit(host_threads);
+			{
+				PhysicsEngine::ShotOptimizer optimizer(course_file ? course_file : "Courses\\Hole1.course", host_threads);
+				PhysicsEngine::ShotSearch search;
+				search.max_strokes = autoplay_strokes;
+				search.step = 1.f/physics_rate;
+
+				std::vector<PhysicsEngine::ShotResult> strokes = optimizer.Play(search);
+				for (unsigned int i = 0; i < strokes.size(); i++)
+				{
+					const PhysicsEngine::ShotResult& stroke = strokes[i];
+					cout << "stroke " << i + 1 << ": offset " << stroke.shot.offset << " strength " << stroke.shot.strength << " swing " << stroke.shot.swing_steps
+						<< " steps -> " << (stroke.holed ? "holed" : (stroke.lost ? "lost" : "rest")) << " after " << stroke.time << "s, "
+						<< stroke.distance << "m from the hole" << endl;
+				}
+				holed = strokes.size() && strokes.back().holed;
+				cout << (holed ? "holed in " : "not holed after ") << strokes.size() << " strokes, " << optimizer.Evaluated() << " candidates in "
+					<< optimizer.EvaluationTime() << "s (" << optimizer.Evaluated()/max(optimizer.EvaluationTime(), 1e-3f) << "/s)" << endl;
+			}
+			PhysicsEngine::PxRelease();
+		}
+		catch (Exception* exc)
+		{
+			cerr << exc->what() << endl;
+			delete exc;
+			return 1;
+		}
+		return holed ? 0 : 1;
+	}
+
+	if (host_matches > 0)
+	{
+		//all matches share the worker pool, the host threads only schedule the steps
+		if (host_threads <= 0)
+			host_threads = max((int)std::thread::hardware_concurrency(), 1);
+		try
+		{
+			PhysicsEngine::PxInit(host_threads);
+			{
+				PhysicsEngine::MatchHost host(host_threads);
+				string course = course_file ? course_file : "Courses\\Hole1.course";
+				for (int i = 0; i < host_matches; i++)
+					host.Create(course, physics_rate);
+
+				host.Start();
+				std::this_thread::sleep_for(std::chrono::duration<float>(host_seconds));
+				host.Stop();
+
+				//per match accounting
+				PhysicsEngine::MatchHost::MatchStats total;
+				std::vector<physx::PxU32> ids = host.Matches();
+				for (unsigned int i = 0; i < ids.size(); i++)
+				{
+					PhysicsEngine::MatchHost::MatchStats stats = host.Stats(ids[i]);
+					if (stats.failed)
+						cout << "match " << ids[i] << " failed: " << stats.error << endl;
+					cout << "match " << ids[i] << ": " << stats.steps << " steps, " << stats.late_steps << " late, wall " << stats.wall_time*1000.f << "ms, host CPU " << stats.host_cpu_time*1000.f << "ms (simulate "
+						<< stats.simulate_time*1000.f << "ms, fetchResults " << stats.fetch_time*1000.f << "ms), longest step " << stats.max_step_time*1000.f << "ms" << endl;
+					total.steps += stats.steps;
+					total.late_steps += stats.late_steps;
+					total.wall_time += stats.wall_time;
+					total.host_cpu_time += stats.host_cpu_time;
+					total.max_step_time = max(total.max_step_time, stats.max_step_time);
+				}
+				cout << ids.size() << " matches on " << host_threads << " threads: " << total.steps << " steps (" << total.steps/max(host_seconds, 1e-3f) << "/s), "
+					<< total.late_steps << " late, wall " << total.wall_time*1000.f << "ms, host CPU " << total.host_cpu_time*1000.f << "ms, longest step " << total.max_step_time*1000.f << "ms" << endl;
+			}
+			PhysicsEngine::PxRelease();
+		}
+		catch (Exception* exc)
+		{
+			cerr << exc->what() << endl;
+			delete exc;
+			return 1;
+		}
+		return 0;
+	}
+
 	try 
 	{ 
-		VisualDebugger::Init("Tutorial 3", 800, 800); 
+		VisualDebugger::Init("Tutorial 3", width, height, course_file, image_file != 0); 
+
+		VisualDebugger::SimulationRate(physics_rate);
+
+		if (spectate_bandwidth > 0)
+			VisualDebugger::Spectate(spectate_bandwidth);
+
+		if (!image_file)
+			VisualDebugger::FrameRate(max_fps, vsync);
+
+		if (capture_prefix)
+			VisualDebugger::Capture(capture_prefix, capture_raw, capture_fps > 0.f ? capture_fps : 60.f);
+
+		if (image_file)
+		{
+			VisualDebugger::Run(frames);
+			VisualDebugger::SaveFrame(image_file);
+			return 0;
+		}
+
+		if (bench_steps)
+		{
+			VisualDebugger::Bench(bench_steps, course_file);
+			return 0;
+		}
 	}
 	catch (Exception exc) 
 	{ 
 		cerr << exc.what() << endl;
 		return 0; 
 	}
+	catch (Exception* exc)
+	{
+		cerr << exc->what() << endl;
+		delete exc;
+		return (image_file || bench_steps) ? 1 : 0;
+	}
 
 	VisualDebugger::Start();
 
 	return 0;
-}
\ No newline at end of file
+}
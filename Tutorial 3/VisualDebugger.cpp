@@ -1,8 +1,19 @@
 #include "VisualDebugger.h"
 #include <vector>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
 #include "Extras\Camera.h"
 #include "Extras\Renderer.h"
 #include "Extras\HUD.h"
+#include "Extras\Snapshot.h"
+#include "Extras\TripleBuffer.h"
+#include "Extras\SnapshotCodec.h"
 
 namespace VisualDebugger
 {
@@ -19,11 +30,23 @@ namespace VisualDebugger
 	{
 		EMPTY = 0,
 		HELP = 1,
-		PAUSE = 2
+		PAUSE = 2,
+		PERF = 3
+	};
+
+	enum PerfPhase
+	{
+		PHASE_SIMULATE,
+		PHASE_FETCH,
+		PHASE_RENDER,
+		PHASE_HUD,
+		PHASE_SWAP,
+		PHASE_COUNT
 	};
 
 	//function declarations
 	void KeyHold();
+	bool ForceKeyHold();
 	void KeySpecial(int key, int x, int y);
 	void KeyRelease(unsigned char key, int x, int y);
 	void KeyPress(unsigned char key, int x, int y);
@@ -31,35 +54,100 @@ namespace VisualDebugger
 	void motionCallback(int x, int y);
 	void mouseCallback(int button, int state, int x, int y);
 	void exitCallback(void);
+	void FinishCapture();
 
 	void RenderScene();
 	void ToggleRenderMode();
 	void HUDInit();
+	void PerfUpdate(PxReal frame_time, const PxReal* phase_times, const SceneSnapshot& snapshot);
+	void PublishSnapshot();
+	void SpectatorUpdate(SceneSnapshot& snapshot);
+	void StartSimulation();
+	void StopSimulation();
 
 	///simulation objects
 	Camera* camera;
 	PhysicsEngine::MyScene* scene;
-	PxReal delta_time = 1.f/60.f;
+	PxReal delta_time = 1.f/60.f; //simulation step
+	PxReal frame_delta = 1.f/60.f; //duration of the last frame (camera movement)
+	const PxReal MAX_FRAME_DELTA = .1f;
+	const PxReal MOUSE_DELTA = 1.f/60.f; //mouse motion is measured in pixels, not per frame
 	PxReal gForceStrength = 20;
 	RenderMode render_mode = NORMAL;
 	const int MAX_KEYS = 256;
-	bool key_state[MAX_KEYS];
+	std::atomic<bool> key_state[MAX_KEYS];
 	bool hud_show = true;
 	HUD hud;
 	int step_count = 0, log_interval = 60;
 
+	///performance overlay
+	typedef std::chrono::high_resolution_clock Clock;
+	const char* phase_names[PHASE_COUNT] = { "simulate", "fetchResults", "render", "HUD", "swap" };
+	const PxU32 PERF_SAMPLES = 240;
+	const PxReal PERF_INTERVAL = .25f; //text refresh interval in seconds
+	bool perf_show = false;
+	PxReal frame_times[PERF_SAMPLES];
+	PxU32 frame_sample = 0;
+	PxReal phase_sums[PHASE_COUNT];
+	PxReal frame_sum = 0.f, frame_max = 0.f;
+	PxU32 perf_frames = 0;
+	Clock::time_point last_frame;
+
+	///simulation thread
+	///The simulation thread owns the scene: it runs the posted commands, steps the scene and publishes a snapshot.
+	///The GLUT thread owns the GL context and only renders the latest snapshot.
+	///The renderer interpolates the poses between the last two steps, so the display is smooth at any refresh rate.
+	///Without the thread (headless runs and captures) every frame advances the scene by frame_step (lockstep).
+	TripleBuffer<SceneSnapshot> snapshots;
+	//the offscreen context lives until exitCallback, a GLUT window may already be gone by then
+	bool offscreen = false;
+	std::thread simulation_thread;
+	std::atomic<bool> simulation_running(false);
+	std::atomic<bool> debug_snapshots(false);
+	bool lockstep = false;
+	PxReal frame_step = 1.f/60.f, lockstep_time = 0.f;
+	PxU32 snapshot_step = 0;
+	//poses of the last published step (simulation thread)
+	SceneSnapshot previous_poses;
+	//render state of the scene, refreshed from the moved actors (simulation thread)
+	SnapshotCache render_cache;
+	//actors of the scene, refilled for every snapshot (simulation thread)
+	std::vector<PxActor*> snapshot_actors;
+	std::mutex command_mutex;
+	std::vector<std::function<void()> > commands, pending_commands;
+
+	///spectator view
+	///Every step goes through the snapshot encoder, a loopback channel and the decoder, and the decoded state is shown:
+	///the window shows what a remote spectator would see.
+	SnapshotEncoder* spectator_encoder = 0;
+	SnapshotDecoder* spectator_decoder = 0;
+	LoopbackChannel spectator_packets, spectator_acks;
+	std::atomic<PxU32> spectator_bytes(0);
+	PxU32 perf_spectator_bytes = 0;
+
+	///input activity since the last frame (keeps the window at full frame rate)
+	bool input_active = false;
+
 	//Init the debugger
-	void Init(const char *window_name, int width, int height)
+	void Init(const char *window_name, int width, int height, const char* course_file, bool headless)
 	{
 		///Init PhysX
 		PhysicsEngine::PxInit();
-		scene = new PhysicsEngine::MyScene();
+		scene = course_file ? new PhysicsEngine::MyScene(course_file) : new PhysicsEngine::MyScene();
 		scene->Init();
+		PublishSnapshot();
 
 		///Init renderer
 		Renderer::BackgroundColor(PxVec3(150.f/255.f,150.f/255.f,150.f/255.f));
 		Renderer::SetRenderDetail(40);
-		Renderer::InitWindow(window_name, width, height);
+		offscreen = headless;
+		if (headless)
+		{
+			if (!Renderer::InitOffscreen(width, height))
+				throw new Exception("VisualDebugger::Init, Offscreen rendering is not available.");
+		}
+		else
+			Renderer::InitWindow(window_name, width, height);
 		Renderer::Init();
 
 		camera = new Camera(PxVec3(-35.0f, 25.0f, -5.0f), PxVec3(1.8f,-.45f,1.f), 5.f);
@@ -67,6 +155,13 @@ namespace VisualDebugger
 		//initialise HUD
 		HUDInit();
 
+		//exit
+		atexit(exitCallback);
+
+		//no window, no input
+		if (headless)
+			return;
+
 		///Assign callbacks
 		//render
 		glutDisplayFunc(RenderScene);
@@ -80,11 +175,11 @@ namespace VisualDebugger
 		glutMouseFunc(mouseCallback);
 		glutMotionFunc(motionCallback);
 
-		//exit
-		atexit(exitCallback);
-
 		//init motion callback
 		motionCallback(0,0);
+
+		//frame pacing: capped frame rate and vertical sync
+		Renderer::VSync(true);
 	}
 
 	void HUDInit()
@@ -96,11 +191,14 @@ namespace VisualDebugger
 		hud.AddLine(HELP, " Player controls");
 		hud.AddLine(HELP, "     I,K,J,L - swing forward, swing backward, move left, move right");
 		hud.AddLine(HELP, "     R - reset game");
+		hud.AddLine(HELP, "     B - drop a practice ball");
 		//add a pause screen
 		hud.AddLine(PAUSE, "");
 		hud.AddLine(PAUSE, "");
 		hud.AddLine(PAUSE, "");
 		hud.AddLine(PAUSE, "   Simulation paused. Press F10 to continue.");
+		//add a performance screen (the lines are filled in by PerfUpdate)
+		hud.AddLine(PERF, " Performance (F11)");
 		//set font size for all screens
 		hud.FontSize(0.018f);
 		//set font color for all screens
@@ -110,34 +208,332 @@ namespace VisualDebugger
 	//Start the main loop
 	void Start()
 	{ 
+		if (!lockstep)
+			StartSimulation();
 		glutMainLoop(); 
 	}
 
+	//Run a fixed number of frames without the main loop
+	void Run(int frames)
+	{
+		//SaveFrame reads the last rendered frame
+		if (frames < 1)
+			throw new Exception("VisualDebugger::Run, At least one frame has to be rendered.");
+
+		if (!lockstep)
+			frame_step = delta_time;
+		lockstep = true;
+		for (int i = 0; i < frames; i++)
+			RenderScene();
+	}
+
+	//Capture all frames at a fixed simulation rate
+	void Capture(const char* prefix, bool raw, PxReal fps)
+	{
+		frame_step = 1.f/fps;
+		lockstep = true;
+		Renderer::StartCapture(prefix, raw);
+	}
+
+	//Set the fixed simulation rate
+	void SimulationRate(PxReal rate)
+	{
+		if (rate <= 0.f)
+			throw new Exception("VisualDebugger::SimulationRate, The rate has to be positive.");
+		delta_time = 1.f/rate;
+	}
+
+	//Show the scene as a spectator receives it
+	void Spectate(PxU32 bytes_per_second)
+	{
+		if (!bytes_per_second)
+			throw new Exception("VisualDebugger::Spectate, The bandwidth has to be positive.");
+
+		//both ends start from the course layout
+		SceneSnapshot layout;
+		std::vector<PxActor*> actors = scene->GetAllActors();
+		TakeSnapshot(actors.size() ? &actors[0] : 0, (PxU32)actors.size(), layout);
+
+		delete spectator_encoder;
+		delete spectator_decoder;
+		spectator_encoder = new SnapshotEncoder(layout, PxMax((PxU32)(bytes_per_second * delta_time), (PxU32)1));
+		spectator_decoder = new SnapshotDecoder(layout);
+		hud.SetLine(HELP, 3, "     B - practice balls are disabled while spectating");
+	}
+
+	//Set the frame pacing of the window
+	void FrameRate(PxReal fps, bool vsync)
+	{
+		Renderer::FrameRate(fps);
+		Renderer::VSync(vsync);
+	}
+
+	//Queue a command for the simulation thread (runs before the next step)
+	//Single key presses are posted, held keys are sampled by the step itself.
+	void Post(const std::function<void()>& command)
+	{
+		std::lock_guard<std::mutex> lock(command_mutex);
+		commands.push_back(command);
+	}
+
+	//Run a command with the simulation stopped (for commands that release PhysX objects)
+	void Synchronized(const std::function<void()>& command)
+	{
+		bool running = simulation_running;
+		if (running)
+			StopSimulation();
+
+		command();
+		scene->ActorsMoved();
+		PublishSnapshot();
+
+		if (running)
+			StartSimulation();
+	}
+
+	//Copy the render state of the scene into the back snapshot and publish it
+	void PublishSnapshot()
+	{
+		SceneSnapshot& snapshot = snapshots.Back();
+
+		scene->GetAllActors(snapshot_actors);
+		const std::vector<PxActor*>& moved = scene->MovedActors();
+		UpdateSnapshot(snapshot_actors.size() ? &snapshot_actors[0] : 0, (PxU32)snapshot_actors.size(), moved.size() ? &moved[0] : 0, (PxU32)moved.size(),
+			scene->Revision(), render_cache, snapshot);
+		TakeDebugSnapshot(debug_snapshots ? &scene->Get()->getRenderBuffer() : 0, snapshot);
+		if (spectator_encoder)
+			SpectatorUpdate(snapshot);
+		CopyPreviousPoses(previous_poses, snapshot);
+		CopyRigidState(snapshot, render_cache, previous_poses);
+		previous_poses.cloths = snapshot.cloths;
+
+		scene->Get()->getSimulationStatistics(snapshot.statistics);
+		snapshot.simulate_time = scene->SimulateTime();
+		snapshot.fetch_time = scene->FetchTime();
+		snapshot.pause = scene->Pause();
+		snapshot.step = ++snapshot_step;
+		snapshot.step_time = delta_time;
+		snapshot.published = Clock::now();
+
+		snapshots.Publish();
+	}
+
+	//Send the snapshot to the spectator and replace it with what the spectator decoded
+	void SpectatorUpdate(SceneSnapshot& snapshot)
+	{
+		unsigned char packet[SnapshotCodec::MAX_PACKET];
+		PxU32 size = spectator_encoder->Encode(snapshot, packet, sizeof(packet));
+		if (size)
+			spectator_packets.Send(packet, size);
+
+		//spectator side: decode and acknowledge
+		while ((size = spectator_packets.Receive(packet, sizeof(packet))) != 0)
+		{
+			if (spectator_decoder->Decode(packet, size))
+			{
+				PxU16 sequence = spectator_decoder->Latest();
+				spectator_acks.Send((const unsigned char*)&sequence, sizeof(sequence));
+			}
+		}
+		spectator_decoder->Apply(snapshot);
+
+		PxU16 sequence;
+		while (spectator_acks.Receive((unsigned char*)&sequence, sizeof(sequence)) == sizeof(sequence))
+			spectator_encoder->Acknowledge(sequence);
+
+		spectator_bytes = spectator_packets.BytesSent();
+	}
+
+	//Run the posted commands, perform a single simulation step and publish the result
+	void Step()
+	{
+		{
+			std::lock_guard<std::mutex> lock(command_mutex);
+			pending_commands.swap(commands);
+		}
+		bool changed = !pending_commands.empty();
+		for (unsigned int i = 0; i < pending_commands.size(); i++)
+			pending_commands[i]();
+		pending_commands.clear();
+
+		//held force keys act on a paused scene too
+		if (ForceKeyHold())
+			changed = true;
+
+		//commands and force keys can move actors that the next step does not report (sleeping or paused)
+		if (changed)
+			scene->ActorsMoved();
+
+		//a paused scene only changes through commands and force keys, nothing to publish otherwise
+		if (scene->Pause() && !changed)
+			return;
+
+		scene->Update(delta_time);
+		PublishSnapshot();
+	}
+
+	//Simulation thread: one step every delta_time seconds, independent of the frame rate
+	void SimulationLoop()
+	{
+		Clock::time_point next_step = Clock::now();
+		while (simulation_running)
+		{
+			Step();
+
+			next_step += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<PxReal>(delta_time));
+			//do not try to catch up after a stall
+			Clock::time_point now = Clock::now();
+			if (next_step < now)
+				next_step = now;
+			std::this_thread::sleep_until(next_step);
+		}
+	}
+
+	void StartSimulation()
+	{
+		if (simulation_running)
+			return;
+		simulation_running = true;
+		simulation_thread = std::thread(SimulationLoop);
+	}
+
+	void StopSimulation()
+	{
+		if (!simulation_running)
+			return;
+		simulation_running = false;
+		simulation_thread.join();
+	}
+
+	//Save the last rendered frame
+	void SaveFrame(const char* file)
+	{
+		std::vector<unsigned char> pixels;
+		Renderer::ReadPixels(pixels);
+
+		std::ofstream output(file, std::ios::out | std::ios::binary);
+		if (!output)
+			throw new Exception("VisualDebugger::SaveFrame, Could not open the image file.");
+
+		int width = Renderer::Width(), height = Renderer::Height();
+		output << "P6\n" << width << " " << height << "\n255\n";
+		//PPM rows run from top to bottom
+		for (int y = height - 1; y >= 0; y--)
+			output.write((const char*)&pixels[y*width*3], width*3);
+	}
+
+	//Time the simulation and the rendering of the course with and without merging the static geometry
+	void Bench(int steps, const char* course_file)
+	{
+		if (steps < 1)
+			throw new Exception("VisualDebugger::Bench, At least one step has to be run.");
+
+		for (int merge = 1; merge >= 0; merge--)
+		{
+			PhysicsEngine::MyScene* bench_scene = new PhysicsEngine::MyScene(course_file ? course_file : "Courses\\Hole1.course",
+				PhysicsEngine::GameParameters(), merge != 0);
+			SnapshotCache cache;
+			SceneSnapshot snapshot;
+			std::vector<PxActor*> actors;
+			double physics_time = 0., snapshot_time = 0., render_time = 0.;
+			try
+			{
+				bench_scene->Init();
+				for (int i = 0; i < steps; i++)
+				{
+					bench_scene->Update(delta_time);
+					physics_time += bench_scene->SimulateTime() + bench_scene->FetchTime();
+
+					Clock::time_point start = Clock::now();
+					bench_scene->GetAllActors(actors);
+					const std::vector<PxActor*>& moved = bench_scene->MovedActors();
+					UpdateSnapshot(actors.size() ? &actors[0] : 0, (PxU32)actors.size(), moved.size() ? &moved[0] : 0, (PxU32)moved.size(),
+						bench_scene->Revision(), cache, snapshot);
+					Clock::time_point snapshotted = Clock::now();
+
+					//the frame is not shown, glFinish waits for the drawing to complete
+					Renderer::Start(camera->getEye(), camera->getDir());
+					Renderer::Render(snapshot);
+					glFinish();
+					Clock::time_point rendered = Clock::now();
+
+					snapshot_time += std::chrono::duration<double>(snapshotted - start).count();
+					render_time += std::chrono::duration<double>(rendered - snapshotted).count();
+				}
+			}
+			catch (Exception*)
+			{
+				delete bench_scene;
+				throw;
+			}
+
+			//every static shape is a broadphase entry and a draw
+			PxU32 static_actors = 0, static_shapes = 0;
+			for (PxU32 i = 0; i < snapshot.actors.size(); i++)
+			{
+				if (snapshot.actors[i].dynamic)
+					continue;
+				static_actors++;
+				static_shapes += snapshot.actors[i].nb_shapes;
+			}
+
+			PhysicsEngine::CourseLayout* layout = bench_scene->Layout();
+			std::cout << "static merge " << (merge ? "on" : "off") << ": " << static_actors << " static actors, " << static_shapes << " static shapes";
+			if (merge && layout)
+				std::cout << " (" << layout->MergedShapes() << " boxes in " << layout->MergedTriangles() << " triangles)";
+			std::cout << std::endl << "  per step: simulate+fetchResults " << physics_time*1000./steps << "ms, snapshot " << snapshot_time*1000./steps
+				<< "ms, render " << render_time*1000./steps << "ms" << std::endl;
+
+			delete bench_scene;
+		}
+	}
+
 	//Render the scene and perform a single simulation step
 	void RenderScene()
 	{
+		Clock::time_point frame_start = Clock::now();
+		PxReal phase_times[PHASE_COUNT];
+
+		//frame time is measured between the starts of consecutive frames
+		PxReal frame_time = (last_frame == Clock::time_point()) ? 0.f : std::chrono::duration<PxReal>(frame_start - last_frame).count();
+		last_frame = frame_start;
+		//the camera moves by real time, lockstep frames by their fixed time step
+		frame_delta = lockstep ? frame_step : PxMin(frame_time, MAX_FRAME_DELTA);
+
 		//handle pressed keys
 		KeyHold();
 
+		//pick up the latest simulation state
+		debug_snapshots = (render_mode == DEBUG) || (render_mode == BOTH);
+		snapshots.Update();
+		const SceneSnapshot& snapshot = snapshots.Front();
+
+		//how far the display is between the previous and the latest step (always the latest step in lockstep)
+		PxReal alpha = 1.f;
+		if (!lockstep && (snapshot.step_time > 0.f))
+			alpha = PxClamp(std::chrono::duration<PxReal>(frame_start - snapshot.published).count() / snapshot.step_time, 0.f, 1.f);
+
 		//start rendering
 		Renderer::Start(camera->getEye(), camera->getDir());
 
 		if ((render_mode == DEBUG) || (render_mode == BOTH))
 		{
-			Renderer::Render(scene->Get()->getRenderBuffer());
+			Renderer::RenderDebug(snapshot);
 		}
 
 		if ((render_mode == NORMAL) || (render_mode == BOTH))
 		{
-			std::vector<PxActor*> actors = scene->GetAllActors();
-			if (actors.size())
-				Renderer::Render(&actors[0], (PxU32)actors.size());
+			Renderer::Render(snapshot, alpha);
 		}
 
+		Clock::time_point rendered = Clock::now();
+
 		//adjust the HUD state
 		if (hud_show)
 		{
-			if (scene->Pause())
+			if (perf_show)
+				hud.ActiveScreen(PERF);
+			else if (snapshot.pause)
 				hud.ActiveScreen(PAUSE);
 			else
 				hud.ActiveScreen(HELP);
@@ -148,16 +544,99 @@ namespace VisualDebugger
 		//render HUD
 		hud.Render();
 
+		//frame-time graph (milliseconds, with the 60Hz budget as reference)
+		if (hud_show && perf_show)
+			Renderer::RenderGraph(frame_times, PERF_SAMPLES, frame_sample, 50.f, 1000.f/60.f,
+				PxVec2(.01f, .02f), PxVec2(.4f, .15f), PxVec3(0.f, .4f, 0.f));
+
+		Clock::time_point hud_rendered = Clock::now();
+
 		//finish rendering
 		Renderer::Finish();
 
-		//perform a single simulation step
-		scene->Update(delta_time);
+		Clock::time_point swapped = Clock::now();
+
+		//advance the simulation by a frame at the fixed rate (the simulation thread steps on its own)
+		if (!simulation_running)
+		{
+			//the tolerance absorbs the rounding of rates that divide each other (e.g. 120Hz physics at 60fps)
+			lockstep_time += frame_step;
+			while (lockstep_time >= delta_time*.999f)
+			{
+				Step();
+				lockstep_time -= delta_time;
+			}
+		}
+
+		phase_times[PHASE_SIMULATE] = snapshot.simulate_time;
+		phase_times[PHASE_FETCH] = snapshot.fetch_time;
+		phase_times[PHASE_RENDER] = std::chrono::duration<PxReal>(rendered - frame_start).count();
+		phase_times[PHASE_HUD] = std::chrono::duration<PxReal>(hud_rendered - rendered).count();
+		phase_times[PHASE_SWAP] = std::chrono::duration<PxReal>(swapped - hud_rendered).count();
+
+		PerfUpdate(frame_time, phase_times, snapshot);
+
+		//drop to a low redraw rate while paused and nothing moves
+		bool keys_held = false;
+		for (int i = 0; (i < MAX_KEYS) && !keys_held; i++)
+			keys_held = key_state[i];
+		Renderer::LowPower(snapshot.pause && !keys_held && !input_active);
+		input_active = false;
 
 		//step_count++;
 		//if (!(step_count % log_interval)) scene->simulationTesting();
 	}
 
+	//collect frame timings, refresh the performance screen a few times per second
+	void PerfUpdate(PxReal frame_time, const PxReal* phase_times, const SceneSnapshot& snapshot)
+	{
+		frame_times[frame_sample] = frame_time * 1000.f;
+		frame_sample = (frame_sample + 1) % PERF_SAMPLES;
+
+		for (int i = 0; i < PHASE_COUNT; i++)
+			phase_sums[i] += phase_times[i];
+		frame_sum += frame_time;
+		frame_max = PxMax(frame_max, frame_time);
+		perf_frames++;
+
+		if ((frame_sum < PERF_INTERVAL) || !perf_show)
+			return;
+
+		const PxSimulationStatistics& stats = snapshot.statistics;
+
+		//formatted into a fixed buffer, lines only rebuild the HUD when their text has changed
+		char line[128];
+		unsigned int index = 1;
+		PxReal average = frame_sum / perf_frames;
+
+		sprintf_s(line, sizeof(line), " frame  %6.2f ms avg  %6.2f ms max  %5.1f fps", average*1000.f, frame_max*1000.f, 1.f/average);
+		hud.SetLine(PERF, index++, line);
+		for (int i = 0; i < PHASE_COUNT; i++)
+		{
+			sprintf_s(line, sizeof(line), " %-12s %6.2f ms", phase_names[i], phase_sums[i] / perf_frames * 1000.f);
+			hud.SetLine(PERF, index++, line);
+		}
+		sprintf_s(line, sizeof(line), " bodies  %u active / %u dynamic  %u static", stats.nbActiveDynamicBodies, stats.nbDynamicBodies, stats.nbStaticBodies);
+		hud.SetLine(PERF, index++, line);
+		sprintf_s(line, sizeof(line), " pairs  %u  contacts  %u  new %u  lost %u", stats.nbDiscreteContactPairsTotal, stats.nbDiscreteContactPairsWithContacts,
+			stats.nbNewTouches, stats.nbLostTouches);
+		hud.SetLine(PERF, index++, line);
+		sprintf_s(line, sizeof(line), " constraints  %u  culled shapes  %u", stats.nbActiveConstraints, Renderer::CulledShapes());
+		hud.SetLine(PERF, index++, line);
+		if (spectator_encoder)
+		{
+			PxU32 bytes = spectator_bytes;
+			sprintf_s(line, sizeof(line), " spectator  %.0f B/s", (bytes - perf_spectator_bytes) / frame_sum);
+			hud.SetLine(PERF, index++, line);
+			perf_spectator_bytes = bytes;
+		}
+
+		for (int i = 0; i < PHASE_COUNT; i++)
+			phase_sums[i] = 0.f;
+		frame_sum = frame_max = 0.f;
+		perf_frames = 0;
+	}
+
 	void UserKeyHold(int key)
 	{
 	}
@@ -168,33 +647,33 @@ namespace VisualDebugger
 		switch (toupper(key))
 		{
 		case 'W':
-			camera->MoveForward(delta_time);
+			camera->MoveForward(frame_delta);
 			break;
 		case 'S':
-			camera->MoveBackward(delta_time);
+			camera->MoveBackward(frame_delta);
 			break;
 		case 'A':
-			camera->MoveLeft(delta_time);
+			camera->MoveLeft(frame_delta);
 			break;
 		case 'D':
-			camera->MoveRight(delta_time);
+			camera->MoveRight(frame_delta);
 			break;
 		case 'Q':
-			camera->MoveUp(delta_time);
+			camera->MoveUp(frame_delta);
 			break;
 		case 'Z':
-			camera->MoveDown(delta_time);
+			camera->MoveDown(frame_delta);
 			break;
 		default:
 			break;
 		}
 	}
 
-	//handle force control keys
-	void ForceInput(int key)
+	//handle force control keys (returns false for other keys)
+	bool ForceInput(int key)
 	{
 		if (!scene->GetSelectedActor())
-			return;
+			return false;
 
 		PxVec3 pos;
 
@@ -217,13 +696,16 @@ namespace VisualDebugger
 			scene->resetGame();
 			break;
 		default:
-			break;
+			return false;
 		}
+		return true;
 	}
 
 	///handle special keys
 	void KeySpecial(int key, int x, int y)
 	{
+		Renderer::LowPower(false);
+
 		//simulation control
 		switch (key)
 		{
@@ -247,15 +729,19 @@ namespace VisualDebugger
 			//simulation control
 		case GLUT_KEY_F9:
 			//select next actor
-			scene->SelectNextActor();
+			Post([]() { scene->SelectNextActor(); });
 			break;
 		case GLUT_KEY_F10:
 			//toggle scene pause
-			scene->Pause(!scene->Pause());
+			Post([]() { scene->Pause(!scene->Pause()); });
+			break;
+		case GLUT_KEY_F11:
+			//performance overlay on/off
+			perf_show = !perf_show;
 			break;
 		case GLUT_KEY_F12:
-			//resect scene
-			scene->Reset();
+			//reset scene (releases the scene, so it cannot run next to a step)
+			Synchronized([]() { scene->Reset(); });
 			break;
 		/*case GLUT_KEY_UP:
 			
@@ -275,10 +761,19 @@ namespace VisualDebugger
 			return;
 
 		key_state[key] = true;
+		Renderer::LowPower(false);
 
-		//exit
+		//exit (the captured frames are read back while the window still exists)
 		if (key == 27)
+		{
+			FinishCapture();
 			exit(0);
+		}
+
+		//practice balls come from a pool, so they can be dropped at any rate
+		//(not while spectating, the spectator codec keeps the actor layout of the course)
+		if ((toupper(key) == 'B') && !spectator_encoder)
+			Post([]() { scene->SpawnPracticeBall(); });
 	}
 
 	//handle key release
@@ -295,12 +790,23 @@ namespace VisualDebugger
 			if (key_state[i]) // if key down
 			{
 				CameraInput(i);
-				ForceInput(i);
 				UserKeyHold(i);
 			}
 		}
 	}
 
+	//handle holded force keys (simulation thread, once per step), returns true if any force key is held
+	bool ForceKeyHold()
+	{
+		bool handled = false;
+		for (int i = 0; i < MAX_KEYS; i++)
+		{
+			if (key_state[i] && ForceInput(i)) // if key down
+				handled = true;
+		}
+		return handled;
+	}
+
 	///mouse handling
 	int mMouseX = 0;
 	int mMouseY = 0;
@@ -310,10 +816,13 @@ namespace VisualDebugger
 		int dx = mMouseX - x;
 		int dy = mMouseY - y;
 
-		camera->Motion(dx, dy, delta_time);
+		camera->Motion(dx, dy, MOUSE_DELTA);
 
 		mMouseX = x;
 		mMouseY = y;
+
+		input_active = true;
+		Renderer::LowPower(false);
 	}
 
 	void mouseCallback(int button, int state, int x, int y)
@@ -332,12 +841,35 @@ namespace VisualDebugger
 			render_mode = NORMAL;
 	}
 
+	//write out the frames still in flight (needs the GL context)
+	void FinishCapture()
+	{
+		try
+		{
+			Renderer::StopCapture();
+		}
+		catch (Exception* exc)
+		{
+			std::cerr << exc->what() << std::endl;
+			delete exc;
+		}
+	}
+
 	///exit callback
 	void exitCallback(void)
 	{
+		StopSimulation();
+
+		//a window capture is finished by the Esc key, the window context can not be used here
+		if (offscreen)
+			FinishCapture();
+
 		delete camera;
+		delete spectator_encoder;
+		delete spectator_decoder;
 		delete scene;
 		PhysicsEngine::PxRelease();
+		Renderer::Release();
 	}
 }
 
@@ -7,9 +7,39 @@ namespace VisualDebugger
 	using namespace physx;
 
 	///Init visualisation
-	void Init(const char *window_name, int width=512, int height=512);
+	///Loads the default course unless a course file is given.
+	///A headless debugger renders into an offscreen buffer of the given size instead of a window.
+	void Init(const char *window_name, int width=512, int height=512, const char* course_file=0, bool headless=false);
 
 	///Start visualisation
 	void Start();
+
+	///Set the fixed simulation rate in steps per second (default 60)
+	///The rendering interpolates between the last two steps, so the rate does not depend on the display.
+	void SimulationRate(PxReal rate);
+
+	///Show the scene as a remote spectator receives it over a link of the given bandwidth
+	///The moving actors and the cloth go through the quantised delta encoding of SnapshotCodec every step.
+	void Spectate(PxU32 bytes_per_second=4096);
+
+	///Set the frame pacing of the window: target frame rate (0 = unlimited) and vertical sync
+	///While the scene is paused and there is no input the window redraws at a low rate.
+	void FrameRate(PxReal fps, bool vsync=true);
+
+	///Render and simulate a number of frames (at least one) without the GLUT main loop (headless mode)
+	void Run(int frames);
+
+	///Capture every frame to an image sequence (or a raw video with raw set)
+	///While capturing, every frame advances the simulation by exactly 1/fps seconds (at the simulation rate),
+	///so the recording plays back at fps regardless of how fast the frames were rendered.
+	void Capture(const char* prefix, bool raw=false, PxReal fps=60.f);
+
+	///Save the last rendered frame as a binary PPM image
+	void SaveFrame(const char* file);
+
+	///Measure a course with and without merging its static geometry (see CourseLayout)
+	///Simulates and renders the given number of steps of a new scene for each setting and prints the average times per step
+	///and the number of static shapes (broadphase entries and draws).
+	void Bench(int steps, const char* course_file=0);
 }
 